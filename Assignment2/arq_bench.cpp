@@ -0,0 +1,343 @@
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Runs the real sender/receiver programs over every point of a parameter
+// matrix, the way the README test cases are run by hand: sender first, then
+// receiver, in a scratch directory holding a data.txt of the point's payload
+// size. Each run's numbers come from the sender's LLC_METRICS row.
+
+struct Matrix {
+    std::vector<std::string> proto{"sw", "gbn", "sr"};
+    std::vector<std::string> N{"8"};
+    std::vector<std::string> p_err{"0"};
+    std::vector<std::string> delay{"0"};
+    std::vector<std::string> size{"100"};
+    int frames = 200;
+    int reps = 3;
+    int warmup = 1;
+    double tol_pct = 10.0;
+    int timeout_s = 120;
+    std::string bin = ".";
+    std::string work = "bench_work";
+    std::string channel;   // LLC_CHANNEL as the driver was started with
+
+    static std::vector<std::string> list(const std::string& v) {
+        std::vector<std::string> out;
+        std::stringstream ss(v);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!item.empty()) out.push_back(item);
+        }
+        return out;
+    }
+
+    // "proto=gbn,sr N=8,32 p_err=0,1e-5 delay=0,10 size=64,1000 reps=5"
+    bool configure(const std::string& spec) {
+        std::stringstream ss(spec);
+        std::string kv;
+        while (ss >> kv) {
+            size_t eq = kv.find('=');
+            if (eq == std::string::npos) { std::cerr << "Bad matrix entry: " << kv << "\n"; return false; }
+            std::string k = kv.substr(0, eq), v = kv.substr(eq + 1);
+            if (k == "proto") proto = list(v);
+            else if (k == "N") N = list(v);
+            else if (k == "p_err") p_err = list(v);
+            else if (k == "delay") delay = list(v);
+            else if (k == "size") size = list(v);
+            else if (k == "frames") frames = std::stoi(v);
+            else if (k == "reps") reps = std::max(1, std::stoi(v));
+            else if (k == "warmup") warmup = std::max(0, std::stoi(v));
+            else if (k == "tol") tol_pct = std::stod(v);
+            else if (k == "timeout") timeout_s = std::stoi(v);
+            else if (k == "bin") bin = v;
+            else if (k == "work") work = v;
+            else { std::cerr << "Unknown matrix key: " << k << "\n"; return false; }
+        }
+        for (auto& p : proto) {
+            if (p != "sw" && p != "gbn" && p != "sr") { std::cerr << "Unknown protocol: " << p << "\n"; return false; }
+        }
+        return true;
+    }
+};
+
+struct Point {
+    std::string proto, N, p_err, delay, size;
+    std::string key() const { return proto + "," + N + "," + p_err + "," + delay + "," + size; }
+};
+
+// One CSV row keyed by header name.
+using Row = std::map<std::string, std::string>;
+
+static std::vector<std::string> split_csv(const std::string& line) {
+    std::vector<std::string> out;
+    std::stringstream ss(line);
+    std::string cell;
+    while (std::getline(ss, cell, ',')) out.push_back(cell);
+    return out;
+}
+
+static std::vector<Row> read_csv(const std::string& path) {
+    std::vector<Row> rows;
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line)) return rows;
+    auto header = split_csv(line);
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        auto cells = split_csv(line);
+        Row r;
+        for (size_t i = 0; i < header.size() && i < cells.size(); ++i) r[header[i]] = cells[i];
+        rows.push_back(r);
+    }
+    return rows;
+}
+
+static double num(const Row& r, const char* k) {
+    auto it = r.find(k);
+    return it == r.end() || it->second.empty() ? 0.0 : std::atof(it->second.c_str());
+}
+
+static double median(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+// Fixed-size lines of random bytes, avoiding the line terminators
+// read_payloads splits on.
+static bool write_data(const std::string& path, int frames, int size) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (int i = 0; i < frames; ++i) {
+        for (int j = 0; j < size; ++j) {
+            int b;
+            do { b = byte(rng); } while (b == '\n' || b == '\r');
+            out.put(char(b));
+        }
+        out.put('\n');
+    }
+    return bool(out);
+}
+
+struct Child {
+    PROCESS_INFORMATION pi{};
+    HANDLE log = INVALID_HANDLE_VALUE;
+
+    bool start(const std::string& exe, const std::string& args, const std::string& dir, const std::string& log_path) {
+        SECURITY_ATTRIBUTES sa{sizeof(sa), nullptr, TRUE};
+        log = CreateFileA(log_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &sa, CREATE_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL, nullptr);
+        STARTUPINFOA si{};
+        si.cb = sizeof(si);
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        si.hStdOutput = log;
+        si.hStdError = log;
+        std::string cmd = "\"" + exe + "\" " + args;
+        std::vector<char> line(cmd.begin(), cmd.end());
+        line.push_back('\0');
+        if (!CreateProcessA(exe.c_str(), line.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr,
+                            dir.c_str(), &si, &pi)) {
+            std::cerr << "CreateProcess failed for " << exe << " (error " << GetLastError() << ")\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Exit code, or -1 if the process had to be killed.
+    int finish(DWORD timeout_ms) {
+        if (!pi.hProcess) return -1;
+        int code = -1;
+        if (WaitForSingleObject(pi.hProcess, timeout_ms) == WAIT_OBJECT_0) {
+            DWORD c = 0;
+            if (GetExitCodeProcess(pi.hProcess, &c)) code = int(c);
+        } else {
+            TerminateProcess(pi.hProcess, 1);
+            WaitForSingleObject(pi.hProcess, INFINITE);
+        }
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+        if (log != INVALID_HANDLE_VALUE) CloseHandle(log);
+        pi = {};
+        log = INVALID_HANDLE_VALUE;
+        return code;
+    }
+};
+
+// One sender/receiver pair. Returns the sender's metrics row, or an empty
+// row if either side failed or ran past the timeout.
+static Row run_once(const Matrix& mx, const Point& pt, const std::string& dir, int run) {
+    std::string tx, rx, tx_args, rx_args;
+    std::string link = pt.p_err + " " + pt.delay;
+    if (pt.proto == "sw") {
+        tx = "stopwait_sender"; rx = "stopwait_receiver";
+        tx_args = link; rx_args = link;
+    } else if (pt.proto == "gbn") {
+        tx = "gobackn_sender"; rx = "gobackn_receiver";
+        tx_args = pt.N + " " + link; rx_args = link;
+    } else {
+        tx = "sr_sender"; rx = "sr_receiver";
+        tx_args = pt.N + " " + link; rx_args = pt.N + " " + link;
+    }
+
+    std::string metrics = dir + "/metrics.csv";
+    DeleteFileA(metrics.c_str());
+    // Run k of every point sees the same channel errors, so lossy points
+    // compare like for like against the baseline. Each child takes its
+    // environment when started. The receiver, whose channel carries the
+    // ACKs, draws its bit errors from a seed of its own, so the two
+    // directions do not fail in step. It writes no metrics, so only the
+    // sender's row lands in the file.
+    std::string spec = mx.channel;
+    if (spec.find("seed") == std::string::npos) spec += " seed=" + std::to_string(run + 1);
+    SetEnvironmentVariableA("LLC_METRICS", "metrics.csv");
+    SetEnvironmentVariableA("LLC_CHANNEL", spec.c_str());
+
+    Child sender, receiver;
+    if (!sender.start(mx.bin + "/" + tx + ".exe", tx_args, dir, dir + "/sender.log")) return {};
+    Sleep(300);   // the sender must be listening before the receiver connects
+    spec += " seed.bits=" + std::to_string(1000000 + run + 1);
+    SetEnvironmentVariableA("LLC_METRICS", nullptr);
+    SetEnvironmentVariableA("LLC_CHANNEL", spec.c_str());
+    if (!receiver.start(mx.bin + "/" + rx + ".exe", rx_args, dir, dir + "/receiver.log")) {
+        sender.finish(0);
+        return {};
+    }
+    DWORD timeout_ms = DWORD(mx.timeout_s) * 1000;
+    int tx_code = sender.finish(timeout_ms);
+    receiver.finish(tx_code == 0 ? timeout_ms : 0);
+    if (tx_code != 0) return {};
+
+    for (auto& r : read_csv(metrics)) {
+        if (r["program"] == tx) return r;
+    }
+    return {};
+}
+
+struct Result {
+    Point pt;
+    int ok = 0;
+    double goodput_bps = 0.0;
+    double retx_ratio = 0.0;
+    double p50_ms = 0.0, p99_ms = 0.0;
+};
+
+static const char* HEADER = "protocol,N,p_err,max_delay_ms,payload_bytes,runs,goodput_bps,retx_ratio,"
+                            "latency_p50_ms,latency_p99_ms,base_goodput_bps,goodput_delta_pct,"
+                            "base_latency_p99_ms,latency_p99_delta_pct,verdict";
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: arq_bench <matrix> <out.csv> [baseline.csv]\n"
+                  << "  matrix: \"proto=sw,gbn,sr N=8,32 p_err=0,1e-5 delay=0,10 size=64,1000"
+                  << " frames=200 reps=3 warmup=1 tol=10\"\n";
+        return 1;
+    }
+    Matrix mx;
+    if (!mx.configure(argv[1])) return 1;
+    if (const char* env = std::getenv("LLC_CHANNEL")) mx.channel = env;
+    std::string out_path = argv[2];
+
+    std::map<std::string, Row> baseline;
+    if (argc >= 4) {
+        for (auto& r : read_csv(argv[3])) {
+            Point p{r["protocol"], r["N"], r["p_err"], r["max_delay_ms"], r["payload_bytes"]};
+            baseline[p.key()] = r;
+        }
+        std::cout << "[BENCH] Baseline " << argv[3] << ": " << baseline.size() << " points\n";
+    }
+
+    std::vector<Point> points;
+    for (auto& pr : mx.proto)
+        for (auto& n : pr == "sw" ? std::vector<std::string>{"1"} : mx.N)
+            for (auto& p : mx.p_err)
+                for (auto& d : mx.delay)
+                    for (auto& s : mx.size) points.push_back({pr, n, p, d, s});
+
+    CreateDirectoryA(mx.work.c_str(), nullptr);
+    std::cout << "[BENCH] " << points.size() << " points x (" << mx.warmup << " warm-up + " << mx.reps
+              << " runs), " << mx.frames << " frames each\n";
+
+    std::ofstream out(out_path, std::ios::trunc);
+    if (!out) { std::cerr << "Cannot create " << out_path << "\n"; return 1; }
+    out << HEADER << "\n";
+
+    int regressions = 0;
+    for (auto& pt : points) {
+        std::string dir = mx.work + "/size" + pt.size;
+        CreateDirectoryA(dir.c_str(), nullptr);
+        if (!write_data(dir + "/data.txt", mx.frames, std::max(1, std::stoi(pt.size)))) {
+            std::cerr << "Cannot write " << dir << "/data.txt\n";
+            return 1;
+        }
+
+        Result res;
+        res.pt = pt;
+        std::vector<double> goodput, ratio, p50, p99;
+        for (int i = 0; i < mx.warmup + mx.reps; ++i) {
+            Row r = run_once(mx, pt, dir, i);
+            if (i < mx.warmup) continue;
+            if (r.empty()) {
+                std::cout << "[BENCH] " << pt.key() << " run " << i - mx.warmup + 1 << " FAILED (logs in " << dir
+                          << ")\n";
+                continue;
+            }
+            double first = num(r, "frames_sent");
+            goodput.push_back(num(r, "goodput_bps"));
+            ratio.push_back(first > 0 ? (num(r, "transmissions") - first) / first : 0.0);
+            p50.push_back(num(r, "latency_p50_ms"));
+            p99.push_back(num(r, "latency_p99_ms"));
+        }
+        res.ok = int(goodput.size());
+        res.goodput_bps = median(goodput);
+        res.retx_ratio = median(ratio);
+        res.p50_ms = median(p50);
+        res.p99_ms = median(p99);
+
+        // Goodput falling, or tail latency rising, by more than tol% of the
+        // baseline counts as a regression.
+        std::string verdict = res.ok ? "new" : "failed";
+        double base_gp = -1.0, base_p99 = -1.0, d_gp = 0.0, d_p99 = 0.0;
+        auto it = baseline.find(pt.key());
+        if (res.ok && it != baseline.end()) {
+            base_gp = num(it->second, "goodput_bps");
+            base_p99 = num(it->second, "latency_p99_ms");
+            d_gp = base_gp > 0 ? 100.0 * (res.goodput_bps - base_gp) / base_gp : 0.0;
+            d_p99 = base_p99 > 0 ? 100.0 * (res.p99_ms - base_p99) / base_p99 : 0.0;
+            verdict = (d_gp < -mx.tol_pct || d_p99 > mx.tol_pct) ? "REGRESSION" : "ok";
+        }
+        if (verdict == "REGRESSION" || verdict == "failed") ++regressions;
+
+        out << pt.proto << "," << pt.N << "," << pt.p_err << "," << pt.delay << "," << pt.size << "," << res.ok
+            << "," << res.goodput_bps << "," << res.retx_ratio << "," << res.p50_ms << "," << res.p99_ms << ","
+            << base_gp << "," << d_gp << "," << base_p99 << "," << d_p99 << "," << verdict << "\n";
+        out.flush();
+
+        std::cout << "[BENCH] " << pt.proto << " N=" << pt.N << " p_err=" << pt.p_err << " delay=" << pt.delay
+                  << " size=" << pt.size << ": " << res.goodput_bps / 1000.0 << " kbit/s, retx "
+                  << res.retx_ratio << ", p50/p99 " << res.p50_ms << "/" << res.p99_ms << " ms";
+        if (base_gp >= 0) std::cout << " (goodput " << d_gp << "%, p99 " << d_p99 << "%)";
+        std::cout << " " << verdict << "\n";
+    }
+
+    std::cout << "[BENCH] Wrote " << out_path;
+    if (regressions) std::cout << " -- " << regressions << " point(s) regressed or failed";
+    std::cout << "\n";
+    return regressions ? 1 : 0;
+}
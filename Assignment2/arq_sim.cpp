@@ -0,0 +1,206 @@
+#include "llc_arq.h"
+using namespace llc;
+
+// Discrete-event run of the same sender/receiver machines the socket
+// programs use. Frames travel as events on a virtual clock, so a point of
+// the sweep costs only the CPU time of the protocol logic itself.
+struct Sim {
+    using clock = std::chrono::steady_clock;
+    struct Delivery {
+        clock::time_point when;
+        uint64_t order;
+        int to;
+        std::vector<uint8_t> bytes;
+    };
+
+    clock::time_point t;
+    std::vector<Delivery> heap;
+    uint64_t order = 0;
+
+    void push(clock::time_point when, int to, std::vector<uint8_t> bytes) {
+        heap.push_back({when, order++, to, std::move(bytes)});
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+    clock::time_point next() const { return heap.empty() ? clock::time_point::max() : heap.front().when; }
+    Delivery pop() {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Delivery d = std::move(heap.back());
+        heap.pop_back();
+        return d;
+    }
+
+private:
+    static bool later(const Delivery& a, const Delivery& b) {
+        return a.when != b.when ? a.when > b.when : a.order > b.order;
+    }
+};
+
+struct SimLink : ArqLink {
+    Sim& sim;
+    Channel chan;
+    int peer;
+    SimLink(Sim& s, int to, double p_err, int max_delay, const std::string& spec, uint64_t seed)
+        : sim(s), chan{p_err, max_delay, 0.0}, peer(to) {
+        out = &null_log();
+        chan.configure(("seed=" + std::to_string(seed) + " " + spec).c_str(), false);
+    }
+    clock::time_point now() override { return sim.t; }
+    int send(std::vector<uint8_t> wire) override {
+        return chan.impair(std::move(wire), sim.t, [&](clock::time_point when, std::vector<uint8_t> b) {
+            sim.push(when, peer, std::move(b));
+        });
+    }
+};
+
+struct Point {
+    bool complete = false;
+    double seconds = 0.0;
+    double efficiency = 0.0;
+    double analytic = -1.0;
+    uint64_t transmissions = 0;
+    uint64_t delivered = 0;
+    Metrics m;
+};
+
+struct Setup {
+    Payloads payloads;
+    std::string spec;
+    std::string cc = "fixed";
+    double rate_bps = 0.0;
+    double prop_ms = 0.0;
+    double limit_s = 3600.0;
+};
+
+static Point run_point(const Setup& st, const std::string& proto, int N, double p_err, int max_delay, uint64_t seed) {
+    Sim sim;
+    sim.t = Sim::clock::time_point{} + std::chrono::hours(1);
+    const auto t0 = sim.t;
+    SimLink to_rx(sim, 1, p_err, max_delay, st.spec, seed);
+    SimLink to_tx(sim, 0, p_err, max_delay, st.spec, seed + 100);
+
+    std::unique_ptr<ArqMachine> tx, rx;
+    if (proto == "sw") {
+        tx = std::make_unique<StopWaitSender>(to_rx, st.payloads);
+        rx = std::make_unique<StopWaitReceiver>(to_tx);
+    } else if (proto == "gbn") {
+        tx = std::make_unique<GbnSender>(to_rx, st.payloads, std::min(255, N), st.cc);
+        rx = std::make_unique<GbnReceiver>(to_tx, AckPolicy{});
+    } else {
+        auto sr = std::make_unique<SrSender>(to_rx, st.payloads, std::min(128, N), st.cc);
+        sr->harq = proto == "harq";
+        tx = std::move(sr);
+        rx = std::make_unique<SrReceiver>(to_tx, std::min(128, N), false);
+    }
+    ArqMachine* node[2] = {tx.get(), rx.get()};
+
+    const auto limit = t0 + std::chrono::microseconds(int64_t(st.limit_s * 1e6));
+    tx->start();
+    while (!tx->done()) {
+        auto wake = std::min(tx->next_wakeup(), rx->next_wakeup());
+        auto at = std::min(wake, sim.next());
+        if (at == Sim::clock::time_point::max() || at > limit) break;
+        sim.t = std::max(sim.t, at);
+        if (sim.next() <= wake) {
+            Sim::Delivery d = sim.pop();
+            ArqMachine& m = *node[d.to];
+            m.on_frame(d.bytes);
+            if (m.wants_idle() && sim.next() > sim.t) m.on_idle();
+        } else {
+            if (tx->next_wakeup() <= sim.t) tx->on_tick();
+            if (rx->next_wakeup() <= sim.t) rx->on_tick();
+        }
+    }
+
+    Point p;
+    p.complete = tx->done();
+    p.seconds = std::chrono::duration<double>(sim.t - t0).count();
+    p.transmissions = tx->transmissions;
+    p.delivered = rx->delivered;
+    p.m = tx->metrics;
+    RunSummary r;
+    r.protocol = proto;
+    r.N = proto == "sw" ? 1 : N;
+    r.p_err = p_err;
+    r.rate_bps = st.rate_bps;
+    r.one_way_ms = st.prop_ms + max_delay / 2.0;
+    r.m = &p.m;
+    p.analytic = r.analytic();
+    if (p.complete && p.seconds > 0.0 && st.rate_bps > 0.0) {
+        double bits = 0.0;
+        for (auto& pl : st.payloads.lines) bits += 8.0 * double(HEADER_LEN + std::max(pl.size(), MIN_PAYLOAD) + 4);
+        p.efficiency = bits / st.rate_bps / p.seconds;
+    }
+    return p;
+}
+
+int main(int argc, char** argv) {
+    size_t frames = (argc >= 2 ? size_t(std::stoul(argv[1])) : 2000);
+    std::string csv_path = (argc >= 3 ? argv[2] : "arq_sim.csv");
+    Setup st;
+    st.cc = (argc >= 4 ? argv[3] : "fixed");
+
+    // Defaults give the link a finite rate and a real propagation delay;
+    // LLC_CHANNEL overrides any of them.
+    const char* env = std::getenv("LLC_CHANNEL");
+    st.spec = std::string("rate=1e6 prop_ms=10 ") + (env ? env : "");
+    Channel probe{0.0, 0, 0.0};
+    probe.configure(st.spec.c_str(), false);
+    st.rate_bps = probe.rate_bps;
+    st.prop_ms = probe.prop_ms;
+
+    if (!read_payloads("data.txt", st.payloads) || st.payloads.lines.empty()) {
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<int> len(MIN_PAYLOAD, 200), byte('a', 'z');
+        st.payloads.lines.resize(frames);
+        for (auto& p : st.payloads.lines) {
+            p.resize(size_t(len(rng)));
+            for (auto& b : p) b = uint8_t(byte(rng));
+        }
+    }
+    if (st.payloads.size() > frames) st.payloads.lines.resize(frames);
+    std::cout << "[SIM] " << st.payloads.size() << " frames, cc=" << st.cc << "\n";
+
+    std::ofstream csv(csv_path);
+    csv << "sweep,value,protocol,N,p_err,max_delay_ms,complete,seconds,efficiency,transmissions,delivered,"
+           "analytic_efficiency,retx_timeout,retx_nak,rtt_p50_ms,rtt_p99_ms,latency_p50_ms,latency_p99_ms\n";
+
+    const int N0 = 8;
+    const double p0 = 1e-5;
+    const int d0 = 10;
+    const char* protos[] = {"sw", "gbn", "sr", "harq"};
+    uint64_t seed = 1;
+
+    auto sweep = [&](const std::string& name, const std::vector<double>& values) {
+        std::cout << "\n[SIM] efficiency vs " << name << " (defaults N=" << N0 << " p_err=" << p0
+                  << " max_delay=" << d0 << "ms)\n";
+        std::cout << name << "\tsw\tgbn\tsr\tharq\n";
+        for (double v : values) {
+            int N = name == "N" ? int(v) : N0;
+            double p_err = name == "p_err" ? v : p0;
+            int max_delay = name == "max_delay_ms" ? int(v) : d0;
+            std::cout << v;
+            for (const char* proto : protos) {
+                Point p = run_point(st, proto, N, p_err, max_delay, seed);
+                std::cout << "\t";
+                if (p.complete) std::cout << p.efficiency;
+                else std::cout << "n/a";
+                csv << name << "," << v << "," << proto << "," << N << "," << p_err << "," << max_delay << ","
+                    << (p.complete ? 1 : 0) << "," << p.seconds << "," << p.efficiency << ","
+                    << p.transmissions << "," << p.delivered << "," << p.analytic << "," << p.m.retx_timeout
+                    << "," << p.m.retx_nak << "," << p.m.rtt_us.percentile(0.5) / 1000.0 << ","
+                    << p.m.rtt_us.percentile(0.99) / 1000.0 << "," << p.m.latency_us.percentile(0.5) / 1000.0
+                    << "," << p.m.latency_us.percentile(0.99) / 1000.0 << "\n";
+            }
+            std::cout << "\n";
+            seed += 2;
+        }
+    };
+
+    auto t = std::chrono::steady_clock::now();
+    sweep("N", {1, 2, 4, 8, 16, 32, 64, 128});
+    sweep("p_err", {0, 1e-6, 1e-5, 5e-5, 1e-4, 5e-4});
+    sweep("max_delay_ms", {0, 5, 10, 50, 100, 200});
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t).count();
+    std::cout << "\n[SIM] Wrote " << csv_path << " in " << ms << "ms\n";
+    return 0;
+}
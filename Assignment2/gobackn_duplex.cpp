@@ -0,0 +1,61 @@
+#include "llc_file.h"
+#include "llc_duplex.h"
+#include "llc_wire.h"
+using namespace llc;
+
+static const uint16_t PORT = 8000;
+
+int main(int argc, char** argv) {
+    winsock_init();
+    bool listener = argc >= 2 && std::string(argv[1]) == "listen";
+    if (argc < 2 || (!listener && std::string(argv[1]) != "connect")) {
+        std::cerr << "usage: gobackn_duplex <listen|connect> <N> <p_err> <max_delay_ms> [hold_ms] [cc]\n";
+        return 1;
+    }
+    int N = std::min(255, std::max(1, argc >= 3 ? std::stoi(argv[2]) : 4));
+    double p_err = (argc >= 4 ? std::stod(argv[3]) : 0.0);
+    int max_delay = (argc >= 5 ? std::stoi(argv[4]) : 0);
+    int hold_ms = (argc >= 6 ? std::stoi(argv[5]) : 10);
+    std::string cc_kind = (argc >= 7 ? argv[6] : "fixed");
+    Channel chan{p_err, max_delay, 0.0};
+    chan.configure(std::getenv("LLC_CHANNEL"));
+
+    std::unique_ptr<Wire> wire;
+    if (listener) {
+        WireListener l(PORT);
+        std::cout << "[DUPLEX] Listening on " << PORT << " (N=" << N << ", hold=" << hold_ms << "ms)\n";
+        wire = l.accept();
+        if (!wire) return 1;
+    } else {
+        wire = connect_wire("127.0.0.1", PORT);
+    }
+    std::cout << "[DUPLEX] Connection established.\n";
+
+    auto payloads = open_payloads("[DUPLEX]");
+    if (!payloads) return 1;
+    auto sink = open_sink("[DUPLEX]");
+
+    WireLink link(*wire, chan);
+    DuplexEndpoint node(link, *payloads, N, cc_kind, hold_ms);
+    node.sink = sink.get();
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = run_duplex(*wire, node, "[DUPLEX]", max_delay);
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    uint64_t acks = node.piggybacked + node.standalone;
+    std::cout << "[DUPLEX] " << (ok ? "Done. " : "Failed. ") << node.tx.delivered << " frames sent, "
+              << node.rx.delivered << " received in " << elapsed << "s; " << node.tx.transmissions
+              << " data frames, " << node.standalone << " standalone ACKs, " << node.piggybacked
+              << " piggybacked (" << (acks ? 100.0 * double(node.piggybacked) / double(acks) : 0.0) << "%)\n";
+    node.transmissions = node.tx.transmissions;
+    node.delivered = node.rx.delivered;
+    node.metrics = node.tx.metrics;
+    node.metrics.merge(node.rx.metrics);
+    report_metrics("gobackn_duplex", "gbn", N, node, chan, elapsed);
+    if (sink) sink->report("[DUPLEX]");
+
+    chan.close();
+    wire.reset();
+    winsock_cleanup();
+    return ok ? 0 : 1;
+}
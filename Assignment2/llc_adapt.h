@@ -0,0 +1,140 @@
+#pragma once
+#include "llc_arq.h"
+#include <deque>
+
+namespace llc {
+
+// Bit error rate inferred from frame losses. A frame of L bits survives with
+// probability (1-p)^L, so a loss fraction f over frames averaging L bits
+// gives p = 1 - (1-f)^(1/L). Starts from a prior of clean full-size frames,
+// and halves all evidence once it spans HORIZON frames so it can follow a
+// changing channel.
+struct BerEstimator {
+    static constexpr double HORIZON = 1024;
+    static constexpr double PRIOR = 32;
+    double frames = PRIOR;
+    double losses = 0;
+    double bits = PRIOR * 8.0 * (HEADER_LEN + 1500 + 4);
+
+    void add(double f, double lost, double b) {
+        frames += f;
+        losses += lost;
+        bits += b;
+        if (frames > HORIZON) { frames /= 2; losses /= 2; bits /= 2; }
+    }
+    double ber() const {
+        double f = std::min(losses / frames, 0.99);
+        return 1.0 - std::pow(1.0 - f, frames / bits);
+    }
+};
+
+// Payload size with the best expected goodput L/(L+H) * (1-p)^(8(L+H)) for
+// H = header + FCS bytes; setting the derivative to zero gives
+// L^2 + H L = H/q with q = -8 ln(1-p).
+inline size_t best_payload(double ber, size_t max_payload) {
+    const double H = double(HEADER_LEN + 4);
+    double q = -8.0 * std::log1p(-std::min(ber, 0.5));
+    if (q <= 0) return max_payload;
+    double L = (std::sqrt(H * H + 4.0 * H / q) - H) / 2.0;
+    return std::max(MIN_PAYLOAD, std::min(max_payload, size_t(L)));
+}
+
+// Re-cuts another source's payloads as one byte stream into chunks sized
+// for the error rate the sender sees: frames the receiver reported corrupted
+// (NAKs and SACK holes) against what was sent, from `metrics`. Timeouts are
+// left out, as they also follow lost ACKs and delay spikes. The size is
+// revisited every RESIZE_EVERY chunks and changes when the optimum moves by
+// more than an eighth. Flagged chunks, such as a file's FIN, pass through
+// whole. Chunks are cut as the sender first asks for them; the last KEEP
+// stay available for retransmission.
+//
+// The input's own boundaries are not kept, so this suits byte streams such
+// as a file, not line records. at() cuts, resizes and logs through mutable
+// state, so only the sender's own thread may read it.
+struct AdaptiveSegmenter : PayloadSource {
+    static constexpr size_t MAX_PAYLOAD = 1500;
+    static constexpr size_t RESIZE_EVERY = 16;
+    static constexpr size_t KEEP = 512;
+
+    struct Cut {
+        std::vector<uint8_t> bytes;
+        uint8_t flags = 0;
+    };
+
+    const PayloadSource& inner;
+    ArqLink& link;
+    std::string tag;
+    const Metrics* metrics = nullptr;
+    mutable std::deque<Cut> cuts;
+    mutable size_t first = 0;       // index of cuts.front()
+    mutable size_t next = 0;        // inner chunk being consumed
+    mutable size_t offset = 0;      // bytes of it already cut
+    mutable size_t target = MAX_PAYLOAD;
+    mutable BerEstimator est;
+    mutable uint64_t seen_sent = 0, seen_lost = 0, seen_bytes = 0;
+    mutable std::chrono::steady_clock::time_point t0{};
+
+    AdaptiveSegmenter(const PayloadSource& p, ArqLink& l, std::string t) : inner(p), link(l), tag(std::move(t)) {}
+
+    // Chunks cut so far, plus one while input remains; exact once the input
+    // is used up.
+    size_t size() const override { return first + cuts.size() + (next < inner.size() ? 1 : 0); }
+
+    Chunk at(size_t i) const override {
+        while (i >= first + cuts.size() && next < inner.size()) cut();
+        if (i < first || i >= first + cuts.size()) return {nullptr, 0, 0};
+        const Cut& c = cuts[i - first];
+        return {c.bytes.data(), c.bytes.size(), c.flags};
+    }
+
+private:
+    void cut() const {
+        size_t n = first + cuts.size();
+        if (n == 0) {
+            t0 = link.now();
+            *link.out << tag << " t=0ms frame size=" << target << "\n";
+        } else if (n % RESIZE_EVERY == 0) {
+            resize();
+        }
+        Cut c;
+        while (next < inner.size()) {
+            Chunk in = inner.at(next);
+            if (in.flags) {
+                if (c.bytes.empty()) {
+                    c.bytes.assign(in.data, in.data + in.size);
+                    c.flags = in.flags;
+                    ++next;
+                    offset = 0;
+                }
+                break;
+            }
+            size_t take = std::min(in.size - offset, target - c.bytes.size());
+            c.bytes.insert(c.bytes.end(), in.data + offset, in.data + offset + take);
+            offset += take;
+            if (offset == in.size) { ++next; offset = 0; }
+            if (c.bytes.size() == target) break;
+        }
+        cuts.push_back(std::move(c));
+        if (cuts.size() > KEEP) { cuts.pop_front(); ++first; }
+    }
+
+    void resize() const {
+        if (!metrics) return;
+        const Metrics& m = *metrics;
+        uint64_t lost = m.retx_nak - seen_lost;
+        uint64_t frames = m.frames_sent - seen_sent + lost;
+        if (frames == 0) return;
+        est.add(double(frames), double(lost), 8.0 * double(m.wire_bytes - seen_bytes));
+        seen_sent = m.frames_sent;
+        seen_lost = m.retx_nak;
+        seen_bytes = m.wire_bytes;
+        size_t best = best_payload(est.ber(), MAX_PAYLOAD);
+        if (best * 8 > target * 9 || best * 8 < target * 7) {
+            target = best;
+            auto t = std::chrono::duration_cast<std::chrono::milliseconds>(link.now() - t0).count();
+            *link.out << tag << " t=" << t << "ms frame size=" << target << " (BER~" << est.ber() << ")\n";
+        }
+    }
+};
+
+} // namespace llc
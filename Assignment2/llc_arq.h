@@ -0,0 +1,1283 @@
+#pragma once
+#include "llc_common.h"
+#include "llc_timer.h"
+#include "llc_window.h"
+#include "llc_cc.h"
+#include "llc_harq.h"
+#include "llc_metrics.h"
+#include <functional>
+
+namespace llc {
+
+// Payloads in send order. A Chunk handed out must stay valid for as long
+// as its frame can still be retransmitted, i.e. while it is in the window.
+struct PayloadSource {
+    virtual ~PayloadSource() = default;
+    virtual size_t size() const = 0;
+    virtual Chunk at(size_t i) const = 0;
+};
+
+// Receivers hand every payload here in order, exactly once.
+struct PayloadSink {
+    virtual ~PayloadSink() = default;
+    virtual void consume(std::vector<uint8_t>& payload, uint8_t flags) = 0;
+    // Bytes it can take before it falls behind; receivers shrink their
+    // advertised window to fit.
+    virtual size_t room() const { return SIZE_MAX; }
+    // When it next wants poll() even if no payload arrives.
+    virtual std::chrono::steady_clock::time_point due() const { return std::chrono::steady_clock::time_point::max(); }
+    virtual void poll() {}
+};
+
+// A data frame encoded ahead of time, e.g. by a framing thread.
+struct Framed {
+    size_t idx = 0;
+    size_t len = 0;
+    uint32_t ts = 0;
+    std::vector<uint8_t> wire;
+};
+
+// data.txt mode: one payload per line, held in memory. Lines are kept as
+// they are; the full frame format pads short ones on the wire.
+struct Payloads : PayloadSource {
+    std::vector<std::vector<uint8_t>> lines;
+    size_t size() const override { return lines.size(); }
+    Chunk at(size_t i) const override { return {lines[i].data(), lines[i].size(), 0}; }
+};
+
+inline bool read_payloads(const std::string& path, Payloads& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        out.lines.emplace_back(line.begin(), line.end());
+    }
+    return true;
+}
+
+inline std::ostream& null_log() {
+    static std::ostream s(nullptr);
+    return s;
+}
+
+// The outside world as a protocol machine sees it: a clock, the impaired
+// link towards the peer, and a log. Socket programs back it with the wall
+// clock and a Channel; the simulator with virtual time.
+struct ArqLink {
+    using clock = std::chrono::steady_clock;
+    std::ostream* out = &std::cout;
+    virtual ~ArqLink() = default;
+    virtual clock::time_point now() = 0;
+    // Copies put on the link (0 if the channel dropped it), -1 on failure.
+    virtual int send(std::vector<uint8_t> wire) = 0;
+};
+
+// One end of an ARQ protocol as an event-driven state machine. Drivers hand
+// it whole frames from the peer and call on_tick() once next_wakeup() has
+// passed; it never blocks and reads time only through its link.
+struct ArqMachine {
+    using clock = std::chrono::steady_clock;
+    ArqLink& link;
+    bool failed = false;
+    uint64_t transmissions = 0;   // data frames put on the link (sender)
+    uint64_t delivered = 0;       // frames acked (sender) or accepted (receiver)
+    PayloadSink* sink = nullptr;  // receivers: in-order payloads, if set
+    uint8_t stream = 0;           // stream ID stamped on every frame sent
+    uint8_t adv_win = 255;        // receivers: window last advertised
+    bool compact = false;         // receivers: announce compact frames are welcome
+    clock::time_point win_poll = clock::time_point::max();
+    Metrics metrics;
+
+    explicit ArqMachine(ArqLink& l) : link(l) {}
+    virtual ~ArqMachine() = default;
+
+    virtual void start() {}
+    virtual void on_frame(const std::vector<uint8_t>& buf) = 0;
+    virtual void on_tick() {}
+    // Called once nothing else is waiting to be read, if wants_idle().
+    virtual void on_idle() {}
+    virtual bool wants_idle() const { return false; }
+    virtual clock::time_point next_wakeup() { return clock::time_point::max(); }
+    virtual bool done() const { return false; }
+    // Size of the control frame starting with `type` (senders only).
+    virtual size_t control_len(uint8_t) const { return Ack::WIRE; }
+    // Receivers: the sink's own deadline, for drivers to wait on besides
+    // next_wakeup(), and polling it once that has passed.
+    virtual clock::time_point sink_due() const { return sink ? sink->due() : clock::time_point::max(); }
+    virtual void poll_sink() { if (sink) sink->poll(); }
+
+protected:
+    std::ostream& log() { return *link.out; }
+    clock::time_point now() { return link.now(); }
+    uint32_t stamp() { return timestamp_us(now()); }
+    double ms_since(uint32_t ts) { return llc::ms_since(ts, now()); }
+    int send(std::vector<uint8_t> w) {
+        int r = link.send(std::move(w));
+        if (r < 0) failed = true;
+        return r;
+    }
+    void deliver(std::vector<uint8_t>& payload, uint8_t flags) {
+        ++delivered;
+        metrics.payload_bytes += payload.size();
+        if (sink) sink->consume(payload, flags);
+    }
+    static std::chrono::microseconds rto_us(const RttEstimator& rtt) {
+        return std::chrono::microseconds(int64_t(rtt.rto_ms * 1000.0));
+    }
+
+    // Receivers: `cap` frames, or fewer if the sink only has room for fewer
+    // payloads of the mean size delivered so far.
+    uint8_t window_for(int cap) const {
+        size_t w = size_t(std::min(cap, 255));
+        if (!sink) return uint8_t(w);
+        size_t mean = delivered ? size_t(std::max<uint64_t>(1, metrics.payload_bytes / delivered)) : 1500;
+        return uint8_t(std::min(w, sink->room() / mean));
+    }
+    // While the advertised window is short of cap, win_poll wakes the
+    // receiver every 10 ms to notice the sink catching up.
+    uint8_t advertise(int cap) {
+        adv_win = window_for(cap);
+        win_poll = adv_win < std::min(cap, 255) ? now() + std::chrono::milliseconds(10) : clock::time_point::max();
+        return adv_win;
+    }
+    // A window update is due once the window has reopened from zero or grown
+    // by half of cap since it was last advertised.
+    bool window_update_due(int cap) {
+        if (now() < win_poll) return false;
+        win_poll = now() + std::chrono::milliseconds(10);
+        int w = window_for(cap);
+        return w > adv_win && (adv_win == 0 || w - adv_win >= cap / 2);
+    }
+};
+
+struct FrameBuilder {
+    uint8_t src[6], dst[6];
+    // Plain frames go out in the compact format once this end allows it
+    // (LLC_COMPACT) and the receiver has said it takes them; aggregates and
+    // HARQ frames keep the full header.
+    bool offer_compact = false;
+    bool compact = false;
+    FrameBuilder() { random_mac(src); random_mac(dst); }
+    // True once, when a control frame first shows the receiver agrees.
+    bool agree(bool peer_takes) {
+        if (!peer_takes || !offer_compact || compact) return false;
+        compact = true;
+        return true;
+    }
+    std::vector<uint8_t> encode(uint8_t stream, uint8_t seq, const Chunk& c, uint32_t ts) const {
+        if (compact) return Frame::encode_compact(seq, ts, c.data, std::min<size_t>(c.size, 1500), c.flags, stream);
+        return Frame::encode(src, dst, uint16_t(std::min<size_t>(c.size, 1500)), seq, ts, c.data, c.size, c.flags,
+                             stream);
+    }
+    std::vector<uint8_t> aggregate(uint8_t stream, uint8_t seq, uint32_t ts, const std::vector<Chunk>& parts) const {
+        return Superframe::encode(src, dst, stream, seq, ts, parts);
+    }
+    std::vector<uint8_t> harq(uint8_t stream, uint8_t seq, const Chunk& c, uint32_t ts) const {
+        return Harq::encode(src, dst, stream, seq, ts, c);
+    }
+    std::vector<uint8_t> parity(uint8_t stream, uint8_t seq, const Chunk& c, uint8_t row, uint32_t ts) const {
+        return Harq::parity(src, dst, stream, seq, ts, c, row);
+    }
+};
+
+// ---------------------------------------------------------------- Stop&Wait
+
+struct StopWaitSender : ArqMachine {
+    const PayloadSource& payloads;
+    FrameBuilder fb;
+    RttEstimator rtt;
+    size_t idx = 0;
+    uint8_t seq = 0;
+    std::vector<uint8_t> wire;
+    uint32_t ts = 0;
+    int attempts = 0;
+    size_t payload_len = 0;
+    clock::time_point first_sent{}, deadline = clock::time_point::max();
+
+    StopWaitSender(ArqLink& l, const PayloadSource& p) : ArqMachine(l), payloads(p) {}
+
+    bool done() const override { return idx >= payloads.size(); }
+    clock::time_point next_wakeup() override { return deadline; }
+
+    void start() override { next_frame(); }
+
+    void next_frame() {
+        deadline = clock::time_point::max();
+        if (done()) { log() << "[SENDER] No more data.\n"; return; }
+        ts = stamp();
+        Chunk c = payloads.at(idx);
+        wire = fb.encode(stream, seq, c, ts);
+        payload_len = c.size;
+        attempts = 0;
+        first_sent = now();
+        transmit();
+    }
+
+    // Every attempt is stamped afresh, so the ACK's echo names the attempt
+    // it answers.
+    void transmit() {
+        if (++attempts > 1) {
+            ts = stamp();
+            wire = fb.encode(stream, seq, payloads.at(idx), ts);
+        }
+        ++transmissions;
+        metrics.sent(wire.size(), attempts == 1 ? 1 : 0);
+        int sent = send(wire);
+        if (sent < 0) { log() << "[SENDER] send failed\n"; return; }
+        if (sent == 0) log() << "[SENDER] (Simulated drop) frame seq=" << int(seq) << "\n";
+        else log() << "[SENDER] Sent frame seq=" << int(seq) << ", len=" << wire.size() << "\n";
+        deadline = now() + rto_us(rtt);
+    }
+
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        Ack a{};
+        bool parsed = Ack::parse(buf.data(), buf.size(), a);
+        if (parsed && fb.agree(a.compact)) log() << "[SENDER] Receiver takes compact frames\n";
+        if (!parsed || a.type != ACK) {
+            log() << "[SENDER] Bad ACK/NAK; retransmitting\n";
+            if (!parsed) ++metrics.crc_failures;
+            ++metrics.retx_nak;
+            transmit();
+            return;
+        }
+        // A stale ACK answers a duplicate; resending on it would double
+        // every later frame (sorcerer's apprentice).
+        if (a.seq != seq) {
+            log() << "[SENDER] Stale ACK " << int(a.seq) << " ignored\n";
+            return;
+        }
+        // An ACK echoing an earlier attempt's stamp is ambiguous (Karn).
+        if (a.ts == ts) {
+            double ms = ms_since(a.ts);
+            rtt.observe(ms);
+            metrics.rtt(ms);
+            log() << "[SENDER] ACK " << int(a.seq) << " (RTT=" << ms << "ms, RTO=" << rtt.rto_ms << "ms)\n";
+        } else {
+            log() << "[SENDER] ACK " << int(a.seq)
+                  << " (earlier attempt, no RTT sample; RTO=" << rtt.rto_ms << "ms)\n";
+        }
+        ++delivered;
+        metrics.latency(now() - first_sent);
+        metrics.payload_bytes += payload_len;
+        ++idx;
+        seq = uint8_t(seq + 1);
+        next_frame();
+    }
+
+    void on_tick() override {
+        if (done() || now() < deadline) return;
+        ++metrics.retx_timeout;
+        log() << "[SENDER] Timeout; retransmitting seq=" << int(seq) << " (RTO=" << rtt.rto_ms << "ms)\n";
+        transmit();
+    }
+};
+
+struct StopWaitReceiver : ArqMachine {
+    uint8_t expected = 0;
+
+    using ArqMachine::ArqMachine;
+
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        bool ok_crc = false;
+        Frame f{};
+        if (!Frame::parse(buf, f, ok_crc)) {
+            log() << "[RECV] Bad frame parse -> drop\n";
+            return;
+        }
+        log() << "[RECV] Frame seq=" << int(f.seq) << " len=" << f.length
+              << " (got " << buf.size() << " bytes), CRC=" << (ok_crc ? "OK" : "BAD") << "\n";
+
+        if (ok_crc && f.seq == expected) {
+            expected = uint8_t(expected + 1);
+            deliver(f.payload, f.flags);
+            Ack a{ACK, f.seq, f.ts, stream};
+            a.compact = compact;
+            send(a.serialize());
+            log() << "[RECV] ACK sent for " << int(f.seq) << "\n";
+        } else if (ok_crc && f.seq == uint8_t(expected - 1)) {
+            // Our ACK was lost: the sender is repeating a frame we have.
+            ++metrics.duplicates;
+            Ack a{ACK, f.seq, f.ts, stream};
+            a.compact = compact;
+            send(a.serialize());
+            log() << "[RECV] Duplicate -> re-ACK " << int(f.seq) << "\n";
+        } else {
+            if (!ok_crc) ++metrics.crc_failures;
+            log() << "[RECV] Discarded (crc/seq mismatch). No ACK -> sender will timeout.\n";
+        }
+    }
+};
+
+// ---------------------------------------------------------------- Go-Back-N
+
+struct GbnSender : ArqMachine {
+    // Repeats of the cumulative ACK for base that count as a loss signal.
+    static constexpr int DUP_ACKS = 3;
+
+    struct Slot {
+        std::vector<uint8_t> wire;
+        uint32_t ts = 0;
+        size_t len = 0;
+        clock::time_point sent_at{};
+    };
+
+    const PayloadSource& payloads;
+    FrameBuilder fb;
+    RttEstimator rtt;
+    RingWindow<Slot> frame_cache;
+    uint8_t& base = frame_cache.base;
+    uint8_t nextseq = 0;
+    uint8_t hiseq = 0;
+    size_t idx = 0;
+    std::unique_ptr<CongestionController> cc;
+    clock::time_point t_start{}, timer = clock::time_point::max(), next_send{};
+    int logged_window = -1;
+    int dup_acks = 0;
+    bool fast_done = false;   // base already fast-retransmitted
+    bool fast = false;        // the current go-back was triggered by NAK/dup ACKs
+    PeerWindow peer;
+
+    GbnSender(ArqLink& l, const PayloadSource& p, int n, const std::string& cc_kind)
+        : ArqMachine(l), payloads(p), frame_cache(n), cc(make_controller(cc_kind, n)) {}
+
+    bool done() const override { return base == hiseq && idx >= payloads.size(); }
+
+    clock::time_point next_wakeup() override {
+        return std::min(can_send() ? std::min(timer, next_send) : timer, peer.persist);
+    }
+
+    void start() override {
+        t_start = next_send = now();
+        log_window();
+        pump();
+    }
+
+    int send_window() const { return std::min(cc->window(), peer.win); }
+
+    // Logged when first learned and when it shuts or reopens.
+    void note_window(uint8_t win) {
+        int was = peer.win;
+        if (peer.update(win) && (win == 0 || was == 0 || was == 255)) {
+            log() << "[GBN SENDER] Receiver window=" << int(win) << "\n";
+        }
+    }
+
+    // Shut window, nothing in flight: the next new frame goes out as a probe
+    // each time the persist timer fires.
+    void persist() {
+        if (peer.win > 0 || base != hiseq || idx >= payloads.size()) {
+            peer.persist = clock::time_point::max();
+            return;
+        }
+        if (peer.probe_due(now())) {
+            log() << "[GBN SENDER] Zero window, probing with seq=" << int(nextseq) << "\n";
+            send_frame(nextseq, payloads.at(idx));
+            ++idx;
+            hiseq = uint8_t(hiseq + 1);
+            nextseq = hiseq;
+            restart_timer();
+            return;
+        }
+        peer.hold(now(), rtt.rto_ms);
+    }
+
+    void log_window() {
+        if (cc->window() == logged_window) return;
+        logged_window = cc->window();
+        auto t = std::chrono::duration_cast<std::chrono::milliseconds>(now() - t_start).count();
+        log() << "[GBN SENDER] t=" << t << "ms cwnd=" << cc->cwnd
+              << " window=" << logged_window << " (" << cc->name() << ")\n";
+    }
+
+    void restart_timer() {
+        timer = (base == nextseq) ? clock::time_point::max() : now() + rto_us(rtt);
+    }
+
+    void transmit(uint8_t seq) {
+        ++transmissions;
+        send(frame_cache.at(seq).wire);
+    }
+
+    void send_frame(uint8_t seq, const Chunk& payload) {
+        auto& slot = frame_cache.at(seq);
+        slot.ts = stamp();
+        slot.wire = fb.encode(stream, seq, payload, slot.ts);
+        slot.len = payload.size;
+        slot.sent_at = now();
+        metrics.sent(slot.wire.size(), 1);
+        transmit(seq);
+        log() << "[GBN SENDER] Sent seq=" << int(seq) << "\n";
+    }
+
+    // Frames in [base, hiseq) are cached; after a timeout nextseq goes back
+    // to base and the window re-covers them at the controller's pace.
+    bool can_send() const {
+        return frame_cache.offset(nextseq) < send_window() && (nextseq != hiseq || idx < payloads.size());
+    }
+
+    void pump() {
+        while (can_send() && now() >= next_send && !failed) {
+            bool was_idle = (base == nextseq);
+            if (nextseq == hiseq) {
+                send_frame(nextseq, payloads.at(idx));
+                ++idx;
+                hiseq = uint8_t(hiseq + 1);
+            } else {
+                // Re-stamped, so an ACK echoing it times this transmission.
+                auto& slot = frame_cache.at(nextseq);
+                slot.ts = stamp();
+                slot.wire = fb.encode(stream, nextseq, payloads.at(idx - uint8_t(hiseq - nextseq)), slot.ts);
+                ++(fast ? metrics.retx_nak : metrics.retx_timeout);
+                metrics.sent(slot.wire.size(), 0);
+                transmit(nextseq);
+                log() << "  resend seq=" << int(nextseq) << "\n";
+            }
+            nextseq = uint8_t(nextseq + 1);
+            if (was_idle) restart_timer();
+            next_send = std::max(next_send, now()) + cc->pacing_interval(rtt);
+        }
+    }
+
+    // Goes back to base without waiting for the timer, once per base: the
+    // frames after a loss keep producing NAK/dup ACKs for the same base.
+    void fast_retransmit(const char* why) {
+        if (fast_done || base == hiseq) return;
+        log() << "[GBN SENDER] " << why << ", fast retransmit from " << int(base) << "\n";
+        fast_done = true;
+        fast = true;
+        nextseq = base;
+        cc->on_loss(false, rtt, now());
+        log_window();
+        next_send = now();
+        restart_timer();
+    }
+
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        Ack a{};
+        if (!Ack::parse(buf.data(), buf.size(), a) || (a.type != ACK && a.type != NAK)) {
+            ++metrics.crc_failures;
+            log() << "[GBN SENDER] Bad ACK ignored.\n";
+            return;
+        }
+        if (fb.agree(a.compact)) log() << "[GBN SENDER] Receiver takes compact frames\n";
+        note_window(a.win);
+        if (a.type == NAK) {
+            if (a.seq == base) fast_retransmit("NAK");
+            else log() << "[GBN SENDER] Stale NAK=" << int(a.seq) << "\n";
+            pump();
+            persist();
+            return;
+        }
+        int adv = frame_cache.offset(a.seq);
+        if (adv > 0 && adv <= int(uint8_t(hiseq - base))) {
+            // The ACK echoes the frame that completed it, a.seq - 1. Every
+            // transmission has its own stamp, so a match names the one that
+            // got through; an echo of an earlier one is ambiguous (Karn).
+            const auto& echoed = frame_cache.at(uint8_t(a.seq - 1));
+            log() << "[GBN SENDER] Cumulative ACK=" << int(a.seq) << " base:" << int(base) << "->" << int(a.seq);
+            if (a.ts == echoed.ts) {
+                double ms = ms_since(a.ts);
+                rtt.observe(ms);
+                metrics.rtt(ms);
+                log() << " (RTT=" << ms << "ms";
+            } else {
+                log() << " (no RTT sample";
+            }
+            log() << ", RTO=" << rtt.rto_ms << "ms)\n";
+            if (frame_cache.offset(nextseq) < adv) nextseq = a.seq;
+            for (uint8_t s = base; s != a.seq; s = uint8_t(s + 1)) {
+                metrics.latency(now() - frame_cache.at(s).sent_at);
+                metrics.payload_bytes += frame_cache.at(s).len;
+            }
+            frame_cache.advance_to(a.seq);
+            delivered += uint64_t(adv);
+            dup_acks = 0;
+            fast_done = false;
+            cc->on_ack(adv, rtt);
+            log_window();
+            restart_timer();
+        } else if (adv == 0 && base != hiseq) {
+            log() << "[GBN SENDER] Duplicate ACK=" << int(a.seq) << " (" << ++dup_acks << ")\n";
+            if (dup_acks >= DUP_ACKS) fast_retransmit("3 duplicate ACKs");
+        } else {
+            log() << "[GBN SENDER] Stale/out-of-range ACK=" << int(a.seq) << "\n";
+        }
+        pump();
+        persist();
+    }
+
+    void on_tick() override {
+        if (now() >= timer) {
+            log() << "[GBN SENDER] TIMEOUT, resending window [" << int(base) << "," << int(hiseq) << ")\n";
+            nextseq = base;
+            fast = false;
+            fast_done = true;
+            rtt.rto_ms = std::min(4000.0, rtt.rto_ms * 2.0);
+            cc->on_loss(true, rtt, now());
+            log_window();
+            next_send = now();
+            timer = now() + rto_us(rtt);
+        }
+        pump();
+        persist();
+    }
+};
+
+struct GbnReceiver : ArqMachine {
+    AckPolicy policy;
+    uint8_t expected = 0;
+    uint32_t echo_ts = 0;
+    bool nak_sent = false;   // for the current gap at `expected`
+
+    GbnReceiver(ArqLink& l, AckPolicy p) : ArqMachine(l), policy(p) {}
+
+    clock::time_point next_wakeup() override { return std::min(policy.deadline, win_poll); }
+
+    void send_ack(const char* why) {
+        Ack a{ACK, expected, echo_ts, stream, advertise(255)};
+        a.compact = compact;
+        send(a.serialize());
+        log() << "[GBN RECV] Sent cumulative ACK=" << int(expected) << " (" << why << ")";
+        if (a.win < 255) log() << " win=" << int(a.win);
+        log() << "\n";
+        policy.sent();
+    }
+
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        bool ok = false;
+        Frame f{};
+        Frame::parse(buf, f, ok);
+        log() << "[GBN RECV] seq=" << int(f.seq) << " CRC=" << (ok ? "OK" : "BAD")
+              << " expected=" << int(expected) << "\n";
+
+        if (ok && f.seq == expected) {
+            expected = uint8_t(expected + 1);
+            echo_ts = f.ts;
+            nak_sent = false;
+            deliver(f.payload, f.flags);
+            if (policy.on_in_order(now())) send_ack("in-order");
+        } else {
+            if (!ok) ++metrics.crc_failures;
+            else if (uint8_t(expected - f.seq) < 128) ++metrics.duplicates;
+            log() << "  out-of-order or corrupted -> discard\n";
+            // The first frame past a gap names it; later ones repeat the
+            // cumulative ACK, which the sender counts as duplicates.
+            bool ahead = ok && uint8_t(f.seq - expected) < 128;
+            if ((ahead || !ok) && !nak_sent) {
+                Ack a{NAK, expected, echo_ts, stream, advertise(255)};
+                a.compact = compact;
+                send(a.serialize());
+                nak_sent = true;
+                log() << "[GBN RECV] Sent NAK=" << int(expected) << "\n";
+                policy.sent();
+            } else {
+                send_ack("gap");
+            }
+        }
+    }
+
+    void on_tick() override {
+        if (policy.due(now())) send_ack("delayed");
+        else if (window_update_due(255)) send_ack("window update");
+    }
+};
+
+// ---------------------------------------------------------- Selective Repeat
+
+struct SrSender : ArqMachine {
+    struct Slot {
+        std::vector<uint8_t> wire;
+        size_t idx = 0;
+        size_t len = 0;
+        uint64_t tx_order = 0;
+        uint32_t ts = 0;
+        clock::time_point sent_at{};   // first transmission
+        clock::time_point tx_at{};     // latest transmission
+        bool shared_ts = false;        // parity went out under the data's stamp
+        uint8_t rows = 0;   // HARQ parity rows sent so far
+    };
+
+    const PayloadSource& payloads;
+    FrameBuilder fb;
+    RttEstimator rtt;
+    RingWindow<Slot> window;
+    uint8_t& base = window.base;
+    uint8_t nextseq = 0;
+    size_t idx = 0;
+    uint64_t tx_count = 0;
+    bool sack_peer = false;
+    TimerQueue timers;
+    std::unique_ptr<CongestionController> cc;
+    clock::time_point t_start{}, next_send{};
+    int logged_window = -1;
+    std::vector<uint8_t> due;
+    // Aggregation: up to agg_bytes of subframes per superframe (0 = off).
+    // A superframe cut short by the window waits up to agg_wait for ACKs
+    // to open room before it goes out partly filled.
+    size_t agg_bytes = 0;
+    clock::duration agg_wait{};
+    clock::time_point agg_hold{clock::time_point::max()};
+    std::vector<Chunk> parts;
+    // If set, new frames come prebuilt (seq = idx mod 256) from here instead
+    // of being encoded inline; false means none is ready yet.
+    std::function<bool(Framed&)> prebuilt;
+    Framed pre;
+    // Type-II hybrid ARQ: frames carry per-block CRCs and one parity row; a
+    // NAK whose ts field asks for k rows gets k more rows instead of the
+    // whole frame, until the rows run out.
+    bool harq = false;
+    PeerWindow peer;
+
+    SrSender(ArqLink& l, const PayloadSource& p, int n, const std::string& cc_kind)
+        : ArqMachine(l), payloads(p), window(n), cc(make_controller(cc_kind, n)) {}
+
+    void aggregate(size_t bytes, int wait_ms) {
+        agg_bytes = std::min<size_t>(bytes, 1500);
+        agg_wait = std::chrono::milliseconds(std::max(0, wait_ms));
+    }
+
+    bool done() const override { return base == nextseq && idx >= payloads.size(); }
+
+    clock::time_point next_wakeup() override {
+        auto wake = std::min(timers.next_deadline(), peer.persist);
+        if (!can_send()) return wake;
+        return std::min(wake, agg_hold == clock::time_point::max() ? next_send : std::max(next_send, agg_hold));
+    }
+
+    // Once the receiver has shown it speaks SACK, every control frame is
+    // SACK-sized, even if its type byte arrives corrupted.
+    size_t control_len(uint8_t type) const override {
+        return ((type & ~TAKES_COMPACT) == SACK || sack_peer) ? Sack::WIRE : Ack::WIRE;
+    }
+
+    void start() override {
+        t_start = next_send = now();
+        log_window();
+        push_new();
+    }
+
+    void log_window() {
+        if (cc->window() == logged_window) return;
+        logged_window = cc->window();
+        auto t = std::chrono::duration_cast<std::chrono::milliseconds>(now() - t_start).count();
+        log() << "[SR SENDER] t=" << t << "ms cwnd=" << cc->cwnd
+              << " window=" << logged_window << " (" << cc->name() << ")\n";
+    }
+
+    bool outstanding(uint8_t s) const { return window.offset(s) < int(uint8_t(nextseq - base)); }
+
+    int send_window() const { return std::min(cc->window(), peer.win); }
+
+    // Logged when first learned and when it shuts or reopens.
+    void note_window(uint8_t win) {
+        int was = peer.win;
+        if (peer.update(win) && (win == 0 || was == 0 || was == 255)) {
+            log() << "[SR SENDER] Receiver window=" << int(win) << "\n";
+        }
+    }
+
+    // Shut window, nothing in flight: the next new frame goes out as a probe
+    // each time the persist timer fires.
+    void persist() {
+        if (peer.win > 0 || base != nextseq || idx >= payloads.size()) {
+            peer.persist = clock::time_point::max();
+            return;
+        }
+        if (peer.probe_due(now())) {
+            log() << "[SR SENDER] Zero window, probing with seq=" << int(nextseq) << "\n";
+            bool sent = true;
+            if (prebuilt) sent = take_prebuilt();
+            else send_new(1);
+            if (sent) return;
+        }
+        peer.hold(now(), rtt.rto_ms);
+    }
+
+    // Subframes of an aggregate are resent on their own, so their wire
+    // form is only built if one is actually lost. A resend is stamped
+    // afresh, so the echo in its ACK names this transmission. With a
+    // framing thread the source is that thread's to read, so the frame it
+    // built is re-stamped in place instead of rebuilt.
+    void send_or_resend(uint8_t seq, bool is_resend) {
+        auto& slot = window.at(seq);
+        if (is_resend) {
+            slot.ts = stamp();
+            slot.shared_ts = false;
+            if (prebuilt) Frame::restamp(slot.wire, slot.ts);
+            else slot.wire.clear();
+        }
+        if (slot.wire.empty()) {
+            Chunk c = payloads.at(slot.idx);
+            slot.wire = harq ? fb.harq(stream, seq, c, slot.ts) : fb.encode(stream, seq, c, slot.ts);
+        }
+        ++transmissions;
+        metrics.sent(slot.wire.size(), is_resend ? 0 : 1);
+        send(slot.wire);
+        arm(seq, is_resend);
+        log() << "[SR SENDER] " << (is_resend ? "Resent" : "Sent") << " seq=" << int(seq) << "\n";
+    }
+
+    void send_parity(uint8_t seq, size_t need) {
+        auto& slot = window.at(seq);
+        Chunk c = payloads.at(slot.idx);
+        Harq code(c.size);
+        if (slot.rows >= code.rows()) {
+            send_or_resend(seq, true);
+            return;
+        }
+        size_t first = slot.rows;
+        size_t end = std::min(code.rows(), first + need);
+        for (; slot.rows < end; ++slot.rows) {
+            auto wire = fb.parity(stream, seq, c, slot.rows, slot.ts);
+            ++transmissions;
+            metrics.sent(wire.size(), 0);
+            send(std::move(wire));
+        }
+        slot.shared_ts = true;
+        arm(seq, true);
+        log() << "[SR SENDER] Parity seq=" << int(seq) << " rows " << first << ".." << end - 1 << "\n";
+    }
+
+    void arm(uint8_t seq, bool is_resend) {
+        auto& slot = window.at(seq);
+        slot.tx_order = ++tx_count;
+        slot.tx_at = now();
+        if (!is_resend) slot.sent_at = now();
+        timers.arm(seq, now() + rto_us(rtt));
+    }
+
+    bool can_send() const {
+        return idx < payloads.size() && window.offset(nextseq) < send_window();
+    }
+
+    // Number of new frames for the next transmission; 0 while holding a
+    // window-limited aggregate for more room. Flagged chunks go alone.
+    size_t batch() {
+        if (agg_bytes == 0 || harq || payloads.at(idx).flags) return 1;
+        auto fits = [&](size_t bytes, size_t i) {
+            Chunk c = payloads.at(i);
+            return c.flags == 0 && bytes + Superframe::SUB_OVERHEAD + c.size <= agg_bytes;
+        };
+        size_t room = size_t(send_window() - window.offset(nextseq));
+        size_t k = 0, bytes = 1;
+        while (k < room && k < 255 && idx + k < payloads.size() && (k == 0 || fits(bytes, idx + k))) {
+            bytes += Superframe::SUB_OVERHEAD + payloads.at(idx + k).size;
+            ++k;
+        }
+        bool full = k == 255 || idx + k == payloads.size() || !fits(bytes, idx + k);
+        if (!full && agg_wait.count() > 0) {
+            if (agg_hold == clock::time_point::max()) agg_hold = now() + agg_wait;
+            if (now() < agg_hold) return 0;
+        }
+        agg_hold = clock::time_point::max();
+        return k;
+    }
+
+    void push_new() {
+        while (can_send() && now() >= next_send && !failed) {
+            if (prebuilt) {
+                if (!take_prebuilt()) break;
+            } else {
+                size_t k = batch();
+                if (k == 0) break;
+                send_new(k);
+            }
+            next_send = std::max(next_send, now()) + cc->pacing_interval(rtt);
+        }
+    }
+
+    bool take_prebuilt() {
+        if (!prebuilt(pre)) return false;
+        auto& slot = window.at(nextseq);
+        slot.idx = pre.idx;
+        slot.len = pre.len;
+        slot.ts = pre.ts;
+        slot.wire.swap(pre.wire);
+        slot.shared_ts = false;
+        send_or_resend(nextseq, false);
+        ++idx;
+        nextseq = uint8_t(nextseq + 1);
+        return true;
+    }
+
+    void send_new(size_t k) {
+        uint32_t ts = stamp();
+        for (size_t i = 0; i < k; ++i) {
+            auto& slot = window.at(uint8_t(nextseq + i));
+            slot.idx = idx + i;
+            slot.len = payloads.at(idx + i).size;
+            slot.ts = ts;
+            slot.wire.clear();
+            slot.shared_ts = false;
+            slot.rows = 1;
+        }
+        if (k == 1) {
+            send_or_resend(nextseq, false);
+        } else {
+            parts.clear();
+            for (size_t i = 0; i < k; ++i) parts.push_back(payloads.at(idx + i));
+            transmissions += k;
+            auto wire = fb.aggregate(stream, nextseq, ts, parts);
+            metrics.sent(wire.size(), k);
+            send(std::move(wire));
+            for (size_t i = 0; i < k; ++i) arm(uint8_t(nextseq + i), false);
+            log() << "[SR SENDER] Sent seq=" << int(nextseq) << ".." << int(uint8_t(nextseq + k - 1))
+                  << " aggregated\n";
+        }
+        idx += k;
+        nextseq = uint8_t(nextseq + k);
+    }
+
+    // Every transmission carries its own stamp, so an echo matching the
+    // latest one is an unambiguous RTT sample (Karn); parity sent under the
+    // data's stamp is not. Returns the sample in ms, or -1. The echo only
+    // identifies the transmission; timing runs from when it was handed to
+    // the link, since a prebuilt frame is stamped before that.
+    double rtt_sample(uint8_t seq, uint32_t echo_ts) {
+        if (!outstanding(seq) || window.test(seq)) return -1.0;
+        const auto& slot = window.at(seq);
+        if (slot.shared_ts || slot.ts != echo_ts) return -1.0;
+        double ms = std::chrono::duration<double, std::milli>(now() - slot.tx_at).count();
+        rtt.observe(ms);
+        metrics.rtt(ms);
+        return ms;
+    }
+
+    bool ack_one(uint8_t seq, uint64_t& newest) {
+        if (!outstanding(seq) || window.test(seq)) return false;
+        window.set(seq);
+        timers.cancel(seq);
+        newest = std::max(newest, window.at(seq).tx_order);
+        ++delivered;
+        metrics.latency(now() - window.at(seq).sent_at);
+        metrics.payload_bytes += window.at(seq).len;
+        return true;
+    }
+
+    // Applies a whole SACK at once. Unless the channel reorders, a hole that
+    // was transmitted before some frame this SACK reports is lost: resend it
+    // without waiting for its timer.
+    void apply_sack(const Sack& k) {
+        int inflight = int(uint8_t(nextseq - base));
+        int cum = window.offset(k.base);
+        if (cum > inflight) return;
+        rtt_sample(k.echo_seq, k.ts);
+        uint64_t newest = 0;
+        int newly = 0;
+        for (int i = 0; i < cum; ++i) newly += ack_one(uint8_t(base + i), newest);
+        for (int i = 1; i < int(Sack::BITMAP) * 8; ++i) {
+            if (k.has(i)) newly += ack_one(uint8_t(k.base + i), newest);
+        }
+        log() << "[SR SENDER] SACK base=" << int(k.base) << " newly acked=" << newly << "\n";
+        cc->on_ack(newly, rtt);
+        // Sent now, the parity is newer than anything reported, so the hole
+        // pass below leaves that frame alone.
+        if (harq && k.parity_rows && outstanding(k.parity_seq) && !window.test(k.parity_seq)) {
+            log() << "[SR SENDER] SACK for " << int(k.parity_seq) << " wants " << int(k.parity_rows)
+                  << " parity rows\n";
+            ++metrics.retx_nak;
+            send_parity(k.parity_seq, k.parity_rows);
+            cc->on_loss(false, rtt, now());
+        }
+        for (uint8_t s = base; s != nextseq; s = uint8_t(s + 1)) {
+            if (!window.test(s) && window.at(s).tx_order < newest) {
+                log() << "[SR SENDER] SACK hole seq=" << int(s) << " -> retransmit\n";
+                ++metrics.retx_nak;
+                send_or_resend(s, true);
+                cc->on_loss(false, rtt, now());
+            }
+        }
+        log_window();
+        window.advance();
+    }
+
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        if (buf.size() >= Sack::WIRE) {
+            Sack k;
+            if (Sack::parse(buf.data(), buf.size(), k)) {
+                sack_peer = true;
+                if (fb.agree(k.compact)) log() << "[SR SENDER] Receiver takes compact frames\n";
+                note_window(k.win);
+                apply_sack(k);
+            } else {
+                ++metrics.crc_failures;
+                log() << "[SR SENDER] Bad SACK ignored.\n";
+            }
+        } else {
+            Ack a{};
+            if (Ack::parse(buf.data(), buf.size(), a)) {
+                if (fb.agree(a.compact)) log() << "[SR SENDER] Receiver takes compact frames\n";
+                note_window(a.win);
+                on_ack(a);
+            }
+            else ++metrics.crc_failures;
+        }
+        push_new();
+        persist();
+    }
+
+    void on_ack(const Ack& a) {
+        if (!outstanding(a.seq) || window.test(a.seq)) return;
+        if (a.type == ACK) {
+            double ms = rtt_sample(a.seq, a.ts);
+            window.set(a.seq);
+            timers.cancel(a.seq);
+            ++delivered;
+            metrics.latency(now() - window.at(a.seq).sent_at);
+            metrics.payload_bytes += window.at(a.seq).len;
+            log() << "[SR SENDER] ACK for " << int(a.seq);
+            if (ms >= 0) log() << " (RTT=" << ms << "ms, RTO=" << rtt.rto_ms << "ms)";
+            log() << "\n";
+            cc->on_ack(1, rtt);
+            log_window();
+            window.advance();
+        } else if (a.type == NAK) {
+            ++metrics.retx_nak;
+            if (harq && a.ts > 0) {
+                log() << "[SR SENDER] NAK for " << int(a.seq) << " wants " << a.ts << " parity rows\n";
+                send_parity(a.seq, a.ts);
+            } else {
+                log() << "[SR SENDER] NAK for " << int(a.seq) << " -> retransmit\n";
+                send_or_resend(a.seq, true);
+            }
+            cc->on_loss(false, rtt, now());
+            log_window();
+        }
+    }
+
+    void on_tick() override {
+        due.clear();
+        timers.pop_expired(now(), due);
+        for (uint8_t seq : due) {
+            if (!outstanding(seq) || window.test(seq)) continue;
+            log() << "[SR SENDER] Timeout seq=" << int(seq) << " -> retransmit\n";
+            ++metrics.retx_timeout;
+            rtt.rto_ms = std::min(4000.0, rtt.rto_ms * 1.5);
+            send_or_resend(seq, true);
+            cc->on_loss(true, rtt, now());
+            log_window();
+        }
+        push_new();
+        persist();
+    }
+};
+
+struct SrReceiver : ArqMachine {
+    struct Held {
+        std::vector<uint8_t> payload;
+        uint8_t flags = 0;
+        HarqAssembly harq;
+    };
+
+    int N;
+    bool use_sack;
+    RingWindow<Held> buffer;
+    uint8_t& base = buffer.base;
+    bool sack_pending = false;
+    uint8_t echo_seq = 0;
+    uint32_t echo_ts = 0;
+    uint8_t parity_seq = 0, parity_rows = 0;   // HARQ request for the next SACK
+    std::vector<Superframe::Sub> subs;
+    Harq::Piece piece;
+    std::vector<uint8_t> rebuilt;
+
+    SrReceiver(ArqLink& l, int n, bool sack) : ArqMachine(l), N(n), use_sack(sack), buffer(n) {}
+
+    // One SACK covers every frame that arrived back-to-back.
+    bool wants_idle() const override { return sack_pending; }
+    void on_idle() override { if (sack_pending) flush_sack(); }
+
+    clock::time_point next_wakeup() override { return win_poll; }
+
+    // Window updates acknowledge base - 1, which the sender either has
+    // already seen acked or may now release.
+    void on_tick() override {
+        if (!window_update_due(N)) return;
+        log() << "[SR RECV] window update\n";
+        if (use_sack) flush_sack();
+        else ack(ACK, uint8_t(base - 1), 0);
+    }
+
+    void flush_sack() {
+        Sack k;
+        k.compact = compact;
+        k.stream = stream;
+        k.base = base;
+        k.echo_seq = echo_seq;
+        k.ts = echo_ts;
+        k.win = advertise(N);
+        k.parity_seq = parity_seq;
+        k.parity_rows = parity_rows;
+        int held = 0;
+        for (int i = 1; i < N; ++i) {
+            if (buffer.test(uint8_t(base + i))) { k.mark(i); ++held; }
+        }
+        send(k.serialize());
+        log() << "  -> SACK base=" << int(base) << " (+" << held << " buffered)";
+        if (k.win < N) log() << " win=" << int(k.win);
+        if (parity_rows) log() << " parity seq=" << int(parity_seq) << " x" << int(parity_rows);
+        log() << "\n";
+        sack_pending = false;
+        parity_rows = 0;
+    }
+
+    // In SACK mode the bitmap says what arrived; only a HARQ NAK's parity
+    // request needs a field of its own, and one that would replace another
+    // still pending sends that first.
+    void ack(uint8_t type, uint8_t seq, uint32_t ts) {
+        if (use_sack) {
+            if (type == NAK && ts > 0) {
+                if (parity_rows && parity_seq != seq) flush_sack();
+                parity_seq = seq;
+                parity_rows = uint8_t(std::min<uint32_t>(ts, 255));
+            }
+            sack_pending = true;
+            return;
+        }
+        Ack a{type, seq, ts, stream, advertise(N)};
+        a.compact = compact;
+        send(a.serialize());
+        log() << "  -> " << (type == ACK ? "ACK " : "NAK ") << int(seq);
+        if (a.win < N) log() << " win=" << int(a.win);
+        log() << "\n";
+    }
+
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        bool full = buf.size() >= HEADER_LEN && !is_compact(buf.data(), buf.size());
+        if (full && (buf[15] & FRAME_AGGREGATE)) {
+            on_aggregate(buf);
+            return;
+        }
+        if (full && (buf[15] & FRAME_HARQ)) {
+            on_harq(buf);
+            return;
+        }
+        bool ok = false;
+        Frame f{};
+        if (!Frame::parse(buf, f, ok)) return;
+        log() << "[SR RECV] seq=" << int(f.seq) << " CRC=" << (ok ? "OK" : "BAD")
+              << " base=" << int(base) << "\n";
+
+        if (!ok) {
+            ++metrics.crc_failures;
+            ack(NAK, base, 0);
+            return;
+        }
+        accept(f.seq, f.ts, f.payload, f.flags);
+    }
+
+    // Good subframes are accepted as if they had arrived alone; each bad
+    // one is NAKed by its own seq.
+    void on_aggregate(const std::vector<uint8_t>& buf) {
+        Frame hdr{};
+        if (!Superframe::parse(buf, hdr, subs)) {
+            log() << "[SR RECV] aggregate header CRC=BAD base=" << int(base) << "\n";
+            ++metrics.crc_failures;
+            ack(NAK, base, 0);
+            return;
+        }
+        for (auto& s : subs) {
+            log() << "[SR RECV] seq=" << int(s.seq) << " (aggregate) CRC=" << (s.ok ? "OK" : "BAD")
+                  << " base=" << int(base) << "\n";
+            if (s.ok) {
+                accept(s.seq, hdr.ts, s.payload, 0);
+            } else {
+                ++metrics.crc_failures;
+                ack(NAK, s.seq, 0);
+            }
+        }
+    }
+
+    // HARQ pieces of one seq accumulate until the payload can be rebuilt;
+    // until then each piece is answered by a NAK carrying, in its ts field,
+    // the number of parity rows still missing (0: resend the whole frame).
+    void on_harq(const std::vector<uint8_t>& buf) {
+        Frame hdr{};
+        if (!Harq::parse(buf, hdr, piece)) {
+            log() << "[SR RECV] HARQ header CRC=BAD base=" << int(base) << "\n";
+            ++metrics.crc_failures;
+            ack(NAK, base, 0);
+            return;
+        }
+        uint8_t seq = hdr.seq;
+        if (buffer.offset(seq) >= N || buffer.test(seq)) {
+            if (!piece.parity) accept(seq, hdr.ts, rebuilt, 0);
+            return;
+        }
+        HarqAssembly& as = buffer.at(seq).harq;
+        if (!piece.parity && (!as.active || as.crc != piece.crc || as.code.len != piece.len)) {
+            as.start(piece.len, piece.crc, uint8_t(hdr.flags & ~(FRAME_HARQ | FRAME_PARITY)));
+        }
+        if (!as.active || as.code.len != piece.len) {
+            log() << "[SR RECV] seq=" << int(seq) << " parity without data -> NAK\n";
+            ack(NAK, seq, 0);
+            return;
+        }
+        for (auto& u : piece.units) as.add(u.first, u.second);
+        size_t need = as.missing();
+        log() << "[SR RECV] seq=" << int(seq) << (piece.parity ? " HARQ parity" : " HARQ data")
+              << " missing=" << need << " base=" << int(base) << "\n";
+        if (need == 0 && as.decode(rebuilt)) {
+            accept(seq, hdr.ts, rebuilt, as.flags);
+            return;
+        }
+        ++metrics.crc_failures;
+        ack(NAK, seq, uint32_t(as.missing()));
+    }
+
+    // Totals over every seq's assembly: units recovered by combining damaged
+    // copies, and data blocks rebuilt from parity.
+    std::pair<uint64_t, uint64_t> harq_stats() const {
+        std::pair<uint64_t, uint64_t> t{0, 0};
+        for (auto& h : buffer.slots) {
+            t.first += h.harq.combined;
+            t.second += h.harq.repaired;
+        }
+        return t;
+    }
+
+    void accept(uint8_t seq, uint32_t ts, std::vector<uint8_t>& payload, uint8_t flags) {
+        echo_seq = seq;
+        echo_ts = ts;
+        int diff = buffer.offset(seq);
+        if (diff >= 256 - N) {
+            ++metrics.duplicates;
+            ack(ACK, seq, ts);
+            return;
+        }
+        if (diff >= N) {
+            log() << "  out of window -> drop\n";
+            return;
+        }
+
+        if (!buffer.test(seq)) {
+            buffer.at(seq).payload.swap(payload);
+            buffer.at(seq).flags = flags;
+            buffer.at(seq).harq.reset();
+            buffer.set(seq);
+        } else {
+            ++metrics.duplicates;
+        }
+        int run = buffer.run_length();
+        for (int i = 0; i < run; ++i) {
+            auto& h = buffer.at(uint8_t(base + i));
+            deliver(h.payload, h.flags);
+        }
+        buffer.advance();
+        ack(ACK, seq, ts);
+    }
+};
+
+// ------------------------------------------------------------- wire drivers
+
+struct WireLink : ArqLink {
+    Wire& w;
+    Channel& chan;
+    WireLink(Wire& wire, Channel& c) : w(wire), chan(c) {}
+    clock::time_point now() override { return clock::now(); }
+    int send(std::vector<uint8_t> wire) override { return chan.transmit(w, std::move(wire)); }
+};
+
+// Sender side: control frames are sized from their type byte.
+inline bool run_sender(Wire& w, ArqMachine& m, const char* tag) {
+    m.start();
+    std::vector<uint8_t> buf;
+    while (!m.done() && !m.failed) {
+        int ready = w.wait_readable(m.next_wakeup());
+        if (ready < 0) { std::cerr << "select() failed\n"; return false; }
+        if (ready > 0) {
+            buf.resize(Ack::WIRE);
+            bool ok = w.read_exact(buf.data(), Ack::WIRE, 4000);
+            size_t n = ok ? m.control_len(buf[0]) : 0;
+            if (ok && n > Ack::WIRE) {
+                buf.resize(n);
+                ok = w.read_exact(buf.data() + Ack::WIRE, n - Ack::WIRE, 4000);
+            }
+            if (!ok) { std::cerr << tag << " Connection lost.\n"; return false; }
+            m.on_frame(buf);
+        }
+        m.on_tick();
+    }
+    return !m.failed;
+}
+
+// Receiver side: data frames are delimited by their length field, after
+// the first byte has told the two formats apart. Returns when the sender
+// has been silent for a minute or closes the connection.
+inline void run_receiver(Wire& w, ArqMachine& m, const char* tag, int max_delay) {
+    using clock = std::chrono::steady_clock;
+    const int tail_timeout = std::max(1000, 5 * max_delay + 500);
+    std::vector<uint8_t> buf(MIN_FRAME + 2048);
+    while (true) {
+        if (m.wants_idle() && w.wait_readable(clock::now()) == 0) m.on_idle();
+        auto wake = m.next_wakeup();
+        auto sink_due = m.sink_due();
+        int ready = w.wait_readable(std::min({clock::now() + std::chrono::seconds(60), wake, sink_due}));
+        if (ready == 0) {
+            auto t = clock::now();
+            if (t >= sink_due) m.poll_sink();
+            if (t >= wake) m.on_tick();
+            if (t >= std::min(wake, sink_due)) continue;
+        }
+        if (ready <= 0 || !w.read_exact(buf.data(), 1, 60000)) {
+            std::cout << tag << " Closing.\n";
+            return;
+        }
+        if (is_compact(buf.data(), 1)) {
+            size_t have = 1, need = COMPACT_MIN;
+            bool ok = true;
+            while (ok && have < need) {
+                ok = w.read_exact(buf.data() + have, need - have, tail_timeout);
+                have = need;
+                need = compact_wire_len(buf.data(), have);
+            }
+            if (!ok) {
+                std::cout << tag << " Incomplete frame.\n";
+                continue;
+            }
+            buf.resize(have);
+            m.on_frame(buf);
+            buf.resize(MIN_FRAME + 2048);
+            continue;
+        }
+        if (!w.read_exact(buf.data() + 1, MIN_FRAME - 1, tail_timeout)) {
+            std::cout << tag << " Incomplete frame.\n";
+            continue;
+        }
+
+        uint16_t be_len = (uint16_t(buf[12]) << 8) | uint16_t(buf[13]);
+        size_t payload_len = std::max<size_t>(MIN_PAYLOAD, ntohs(be_len));
+        size_t total = HEADER_LEN + payload_len + 4;
+        if (total > buf.size()) buf.resize(total);
+        if (total > MIN_FRAME && !w.read_exact(buf.data() + MIN_FRAME, total - MIN_FRAME, tail_timeout)) {
+            std::cout << tag << " Incomplete frame.\n";
+            continue;
+        }
+        buf.resize(total);
+        m.on_frame(buf);
+        buf.resize(MIN_FRAME + 2048);
+    }
+}
+
+// LLC_METRICS names a file for the run's counters and histograms: JSON, or
+// one appended CSV row if it ends in .csv.
+inline void report_metrics(const char* program, const char* protocol, int N, const ArqMachine& m,
+                           const Channel& chan, double seconds) {
+    const char* path = std::getenv("LLC_METRICS");
+    if (!path || !*path) return;
+    RunSummary r;
+    r.program = program;
+    r.protocol = protocol;
+    r.N = N;
+    r.p_err = chan.bit_error_prob;
+    r.rate_bps = chan.rate_bps;
+    r.one_way_ms = chan.prop_ms + chan.max_delay_ms / 2.0;
+    r.seconds = seconds;
+    r.transmissions = m.transmissions;
+    r.delivered = m.delivered;
+    r.m = &m.metrics;
+    if (write_metrics(path, r)) std::cout << "[METRICS] " << program << " -> " << path << "\n";
+    else std::cerr << "Cannot write " << path << "\n";
+}
+
+} // namespace llc
@@ -0,0 +1,99 @@
+#pragma once
+#include "llc_common.h"
+#include <memory>
+
+namespace llc {
+
+// Sender-side congestion control. The controller owns the effective window
+// (in frames, capped at the configured N) and the pacing interval between
+// new transmissions; the ARQ loop reports acknowledged frames and losses.
+struct CongestionController {
+    using clock = std::chrono::steady_clock;
+    double cwnd = 1.0;
+    double max_window = 1.0;
+    clock::time_point last_cut{};
+
+    explicit CongestionController(int n) : max_window(std::max(1, n)) {}
+    virtual ~CongestionController() = default;
+
+    virtual const char* name() const = 0;
+    virtual void on_ack(int newly_acked, const RttEstimator& rtt) = 0;
+    virtual void on_loss(bool timeout, const RttEstimator& rtt, clock::time_point now) = 0;
+
+    int window() const { return int(clampd(cwnd, 1.0, max_window)); }
+
+    virtual std::chrono::microseconds pacing_interval(const RttEstimator& rtt) const {
+        if (!rtt.have) return std::chrono::microseconds(0);
+        return std::chrono::microseconds(int64_t(rtt.srtt * 1000.0 / std::max(1.0, cwnd)));
+    }
+
+protected:
+    // Several losses inside one round trip count as a single congestion event.
+    bool new_loss_event(bool timeout, const RttEstimator& rtt, clock::time_point now) {
+        double rtt_ms = rtt.have ? rtt.srtt : rtt.rto_ms;
+        if (!timeout && now - last_cut < std::chrono::microseconds(int64_t(rtt_ms * 1000.0))) return false;
+        last_cut = now;
+        return true;
+    }
+};
+
+// Window pinned at N, no pacing: the classic textbook sender.
+struct FixedWindow : CongestionController {
+    explicit FixedWindow(int n) : CongestionController(n) { cwnd = max_window; }
+    const char* name() const override { return "fixed"; }
+    void on_ack(int, const RttEstimator&) override {}
+    void on_loss(bool, const RttEstimator&, clock::time_point) override {}
+    std::chrono::microseconds pacing_interval(const RttEstimator&) const override { return std::chrono::microseconds(0); }
+};
+
+// Slow start up to ssthresh, then +1 frame per window of ACKs; halve on a
+// loss event, collapse to one frame on timeout.
+struct AimdController : CongestionController {
+    double ssthresh;
+    explicit AimdController(int n) : CongestionController(n), ssthresh(max_window) {}
+    const char* name() const override { return "aimd"; }
+    void on_ack(int newly_acked, const RttEstimator&) override {
+        for (int i = 0; i < newly_acked; ++i)
+            cwnd += (cwnd < ssthresh) ? 1.0 : 1.0 / cwnd;
+        cwnd = std::min(cwnd, max_window);
+    }
+    void on_loss(bool timeout, const RttEstimator& rtt, clock::time_point now) override {
+        if (!new_loss_event(timeout, rtt, now)) return;
+        ssthresh = std::max(1.0, cwnd / 2.0);
+        cwnd = timeout ? 1.0 : ssthresh;
+    }
+};
+
+// Vegas-style: compares the throughput the window should give at the
+// minimum observed RTT with what the current smoothed RTT delivers, and
+// keeps between alpha and beta frames queued in the path.
+struct DelayController : CongestionController {
+    double alpha = 1.0, beta = 3.0;
+    double base_rtt = 0.0;
+    explicit DelayController(int n) : CongestionController(n) { cwnd = std::min(2.0, max_window); }
+    const char* name() const override { return "delay"; }
+    void on_ack(int newly_acked, const RttEstimator& rtt) override {
+        if (!rtt.have) {
+            cwnd = std::min(cwnd + newly_acked, max_window);
+            return;
+        }
+        if (base_rtt <= 0.0 || rtt.srtt < base_rtt) base_rtt = rtt.srtt;
+        double queued = cwnd * (1.0 - base_rtt / std::max(rtt.srtt, 1e-3));
+        double step = double(newly_acked) / cwnd;
+        if (queued < alpha) cwnd += step;
+        else if (queued > beta) cwnd -= step;
+        cwnd = clampd(cwnd, 1.0, max_window);
+    }
+    void on_loss(bool timeout, const RttEstimator& rtt, clock::time_point now) override {
+        if (!new_loss_event(timeout, rtt, now)) return;
+        cwnd = timeout ? 1.0 : std::max(1.0, cwnd * 0.75);
+    }
+};
+
+inline std::unique_ptr<CongestionController> make_controller(const std::string& kind, int n) {
+    if (kind == "aimd") return std::make_unique<AimdController>(n);
+    if (kind == "delay") return std::make_unique<DelayController>(n);
+    return std::make_unique<FixedWindow>(n);
+}
+
+} // namespace llc
@@ -1,244 +1,970 @@
-#pragma once
-#define _WINSOCK_DEPRECATED_NO_WARNINGS
-#ifndef NOMINMAX
-#define NOMINMAX
-#endif
-
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <windows.h>
-#pragma comment(lib, "Ws2_32.lib")
-
-#include <cstdint>
-#include <cstdlib>
-#include <vector>
-#include <string>
-#include <iostream>
-#include <fstream>
-#include <random>
-#include <chrono>
-#include <algorithm>
-#include <atomic>
-#include <map>
-#include <mutex>
-#include <condition_variable>
-
-namespace llc {
-
-inline double clampd(double x, double lo, double hi) {
-    return x < lo ? lo : (x > hi ? hi : x);
-}
-
-inline void winsock_init() {
-    WSADATA wsaData{};
-    int r = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (r != 0) { std::cerr << "WSAStartup failed: " << r << "\n"; std::exit(1); }
-}
-inline void winsock_cleanup() { WSACleanup(); }
-
-inline SOCKET make_listen_socket(uint16_t port) {
-    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (s == INVALID_SOCKET) { std::cerr << "socket() failed\n"; std::exit(1); }
-    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_addr.s_addr = INADDR_ANY; addr.sin_port = htons(port);
-    if (bind(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) { std::cerr << "bind() failed\n"; std::exit(1); }
-    if (listen(s, SOMAXCONN) == SOCKET_ERROR) { std::cerr << "listen() failed\n"; std::exit(1); }
-    return s;
-}
-inline SOCKET make_connect_socket(const char* host, uint16_t port) {
-    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (s == INVALID_SOCKET) { std::cerr << "socket() failed\n"; std::exit(1); }
-    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port);
-    addr.sin_addr.s_addr = inet_addr(host);
-    if (connect(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
-        std::cerr << "connect() failed\n"; closesocket(s); std::exit(1);
-    }
-    return s;
-}
-
-inline bool send_all(SOCKET s, const uint8_t* buf, size_t len) {
-    size_t sent = 0;
-    while (sent < len) {
-        int r = send(s, reinterpret_cast<const char*>(buf + sent), int(len - sent), 0);
-        if (r == SOCKET_ERROR || r == 0) return false;
-        sent += size_t(r);
-    }
-    return true;
-}
-inline bool recv_exact(SOCKET s, uint8_t* buf, size_t len, int timeout_ms) {
-    size_t got = 0;
-    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
-    while (got < len) {
-        auto now = std::chrono::steady_clock::now();
-        int remaining = int(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
-        if (remaining <= 0) return false;
-
-        fd_set fds; FD_ZERO(&fds); FD_SET(s, &fds);
-        timeval tv{}; tv.tv_sec = remaining / 1000; tv.tv_usec = (remaining % 1000) * 1000;
-        int pr = select(0, &fds, nullptr, nullptr, &tv);
-        if (pr <= 0) return false;
-
-        int r = recv(s, reinterpret_cast<char*>(buf + got), int(len - got), 0);
-        if (r <= 0) return false;
-        got += size_t(r);
-    }
-    return true;
-}
-
-struct Channel {
-    double bit_error_prob = 0.0;
-    int max_delay_ms = 0;
-    double loss_prob = 0.0;
-    std::mt19937 rng{ std::random_device{}() };
-    std::uniform_real_distribution<double> U{0.0, 1.0};
-
-    void apply_delay() {
-        if (max_delay_ms <= 0) return;
-        int d = int(U(rng) * (max_delay_ms + 1));
-        Sleep(static_cast<DWORD>(d));
-    }
-    bool maybe_drop() { return U(rng) < loss_prob; }
-
-    void flip_bits(std::vector<uint8_t>& buf) {
-        if (bit_error_prob <= 0.0) return;
-        std::bernoulli_distribution B(bit_error_prob);
-        for (auto& b : buf) {
-            uint8_t m = 0;
-            for (int i = 0; i < 8; ++i) if (B(rng)) m ^= (1u << i);
-            b ^= m;
-        }
-    }
-};
-
-inline uint32_t crc32(const uint8_t* data, size_t len) {
-    static uint32_t table[256];
-    static bool inited = false;
-    if (!inited) {
-        const uint32_t poly = 0xEDB88320u;
-        for (uint32_t i = 0; i < 256; ++i) {
-            uint32_t c = i;
-            for (int j = 0; j < 8; ++j)
-                c = (c & 1) ? (poly ^ (c >> 1)) : (c >> 1);
-            table[i] = c;
-        }
-        inited = true;
-    }
-    uint32_t c = 0xFFFFFFFFu;
-    for (size_t i = 0; i < len; ++i) {
-        c = table[(c ^ data[i]) & 0xFFu] ^ (c >> 8);
-    }
-    return c ^ 0xFFFFFFFFu;
-}
-
-static constexpr size_t MIN_PAYLOAD = 46;
-struct Frame {
-    uint8_t src[6]{};
-    uint8_t dst[6]{};
-    uint16_t length{0};
-    uint8_t seq{0};
-    std::vector<uint8_t> payload;
-    uint32_t fcs{0};
-
-    std::vector<uint8_t> serialize_no_crc() const {
-        std::vector<uint8_t> out;
-        out.insert(out.end(), src, src + 6);
-        out.insert(out.end(), dst, dst + 6);
-        uint16_t be_len = htons(length);
-        out.push_back(uint8_t(be_len >> 8));
-        out.push_back(uint8_t(be_len & 0xFF));
-        out.push_back(seq);
-        out.insert(out.end(), payload.begin(), payload.end());
-        if (out.size() < (15 + MIN_PAYLOAD)) {
-            size_t need = (15 + MIN_PAYLOAD) - out.size();
-            out.insert(out.end(), need, uint8_t(' '));
-        }
-        return out;
-    }
-    std::vector<uint8_t> serialize_with_crc() {
-        auto body = serialize_no_crc();
-        uint32_t c = crc32(body.data(), body.size());
-        fcs = c;
-        body.push_back(uint8_t((c >> 24) & 0xFF));
-        body.push_back(uint8_t((c >> 16) & 0xFF));
-        body.push_back(uint8_t((c >> 8) & 0xFF));
-        body.push_back(uint8_t(c & 0xFF));
-        return body;
-    }
-    static bool parse(const std::vector<uint8_t>& buf, Frame& out) {
-        if (buf.size() < 15 + MIN_PAYLOAD + 4) return false;
-        std::copy(buf.begin(), buf.begin() + 6, out.src);
-        std::copy(buf.begin() + 6, buf.begin() + 12, out.dst);
-        uint16_t be_len = (uint16_t(buf[12]) << 8) | uint16_t(buf[13]);
-        out.length = ntohs(be_len);
-        out.seq = buf[14];
-        size_t header_payload = 15 + std::max<size_t>(MIN_PAYLOAD, out.length);
-        if (buf.size() < header_payload + 4) return false;
-        out.payload.assign(buf.begin() + 15, buf.begin() + 15 + std::max<size_t>(MIN_PAYLOAD, out.length));
-        out.fcs = (uint32_t(buf[header_payload]) << 24) | (uint32_t(buf[header_payload + 1]) << 16)
-                | (uint32_t(buf[header_payload + 2]) << 8) | uint32_t(buf[header_payload + 3]);
-        return true;
-    }
-    static bool verify_crc(const std::vector<uint8_t>& buf) {
-        if (buf.size() < 4) return false;
-        uint32_t got = (uint32_t(buf[buf.size() - 4]) << 24) | (uint32_t(buf[buf.size() - 3]) << 16)
-                     | (uint32_t(buf[buf.size() - 2]) << 8) | uint32_t(buf[buf.size() - 1]);
-        uint32_t calc = crc32(buf.data(), buf.size() - 4);
-        return got == calc;
-    }
-};
-
-enum : uint8_t { ACK = 0x06, NAK = 0x15 };
-struct Ack {
-    uint8_t type{ACK};
-    uint8_t seq{0};
-    uint32_t fcs{0};
-    std::vector<uint8_t> serialize() {
-        std::vector<uint8_t> b{type, seq};
-        uint32_t c = crc32(b.data(), b.size());
-        fcs = c;
-        b.push_back(uint8_t((c >> 24) & 0xFF));
-        b.push_back(uint8_t((c >> 16) & 0xFF));
-        b.push_back(uint8_t((c >> 8) & 0xFF));
-        b.push_back(uint8_t(c & 0xFF));
-        return b;
-    }
-    static bool parse(const uint8_t* buf, size_t len, Ack& out) {
-        if (len < 6) return false;
-        out.type = buf[0];
-        out.seq = buf[1];
-        uint32_t got = (uint32_t(buf[2]) << 24) | (uint32_t(buf[3]) << 16) | (uint32_t(buf[4]) << 8) | uint32_t(buf[5]);
-        std::vector<uint8_t> b{out.type, out.seq};
-        uint32_t calc = crc32(b.data(), b.size());
-        if (got != calc) return false;
-        out.fcs = got;
-        return true;
-    }
-};
-
-inline void random_mac(uint8_t mac[6]) {
-    static std::mt19937 rng{ std::random_device{}() };
-    std::uniform_int_distribution<int> D(0, 255);
-    for (int i = 0; i < 6; ++i) mac[i] = uint8_t(D(rng));
-    mac[0] &= 0xFE;
-    mac[0] |= 0x02;
-}
-
-struct RttEstimator {
-    bool have = false;
-    double srtt = 0.0, rttvar = 0.0;
-    double rto_ms = 1000.0;
-    void observe(double sample_ms) {
-        if (!have) {
-            srtt = sample_ms;
-            rttvar = sample_ms / 2.0;
-            have = true;
-        } else {
-            const double alpha = 1.0 / 8.0;
-            const double beta  = 1.0 / 4.0;
-            rttvar = (1.0 - beta) * rttvar + beta * std::abs(srtt - sample_ms);
-            srtt   = (1.0 - alpha) * srtt   + alpha * sample_ms;
-        }
-        rto_ms = clampd(srtt + 4.0 * rttvar, 200.0, 4000.0);
-    }
-};
-
-} // namespace llc
+#pragma once
+#define _WINSOCK_DEPRECATED_NO_WARNINGS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#pragma comment(lib, "Ws2_32.lib")
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+
+namespace llc {
+
+inline double clampd(double x, double lo, double hi) {
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// A switch set in the environment: present, non-empty and not "0".
+inline bool env_flag(const char* name) {
+    const char* v = std::getenv(name);
+    return v && *v && std::string(v) != "0";
+}
+
+inline void winsock_init() {
+    WSADATA wsaData{};
+    int r = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (r != 0) { std::cerr << "WSAStartup failed: " << r << "\n"; std::exit(1); }
+}
+inline void winsock_cleanup() { WSACleanup(); }
+
+// `flags` as for WSASocket; the default matches socket().
+inline SOCKET make_listen_socket(uint16_t port, DWORD flags = WSA_FLAG_OVERLAPPED) {
+    SOCKET s = WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, flags);
+    if (s == INVALID_SOCKET) { std::cerr << "socket() failed\n"; std::exit(1); }
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_addr.s_addr = INADDR_ANY; addr.sin_port = htons(port);
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) { std::cerr << "bind() failed\n"; std::exit(1); }
+    if (listen(s, SOMAXCONN) == SOCKET_ERROR) { std::cerr << "listen() failed\n"; std::exit(1); }
+    return s;
+}
+inline SOCKET make_connect_socket(const char* host, uint16_t port, DWORD flags = WSA_FLAG_OVERLAPPED) {
+    SOCKET s = WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, flags);
+    if (s == INVALID_SOCKET) { std::cerr << "socket() failed\n"; std::exit(1); }
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(host);
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+        std::cerr << "connect() failed\n"; closesocket(s); std::exit(1);
+    }
+    return s;
+}
+
+inline bool send_all(SOCKET s, const uint8_t* buf, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        int r = send(s, reinterpret_cast<const char*>(buf + sent), int(len - sent), 0);
+        if (r == SOCKET_ERROR || r == 0) return false;
+        sent += size_t(r);
+    }
+    return true;
+}
+inline bool recv_exact(SOCKET s, uint8_t* buf, size_t len, int timeout_ms) {
+    size_t got = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (got < len) {
+        auto now = std::chrono::steady_clock::now();
+        int remaining = int(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+        if (remaining <= 0) return false;
+
+        fd_set fds; FD_ZERO(&fds); FD_SET(s, &fds);
+        timeval tv{}; tv.tv_sec = remaining / 1000; tv.tv_usec = (remaining % 1000) * 1000;
+        int pr = select(0, &fds, nullptr, nullptr, &tv);
+        if (pr <= 0) return false;
+
+        int r = recv(s, reinterpret_cast<char*>(buf + got), int(len - got), 0);
+        if (r <= 0) return false;
+        got += size_t(r);
+    }
+    return true;
+}
+
+inline int wait_readable(SOCKET s, std::chrono::steady_clock::time_point deadline) {
+    fd_set fds; FD_ZERO(&fds); FD_SET(s, &fds);
+    timeval tv{};
+    timeval* ptv = nullptr;
+    if (deadline != std::chrono::steady_clock::time_point::max()) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (us < 0) us = 0;
+        tv.tv_sec = long(us / 1000000); tv.tv_usec = long(us % 1000000);
+        ptv = &tv;
+    }
+    int r = select(0, &fds, nullptr, nullptr, ptv);
+    if (r == SOCKET_ERROR) return -1;
+    return r > 0 ? 1 : 0;
+}
+
+// The byte stream to the peer. Each write() carries whole frames; readers
+// still delimit them from the bytes. A wire may hold writes back until
+// flush(), which writers call when they have nothing more to send for now;
+// waiting or reading flushes too. `direct` wires are cheap enough to write
+// from the protocol thread when the channel adds no delay.
+struct Wire {
+    bool direct = false;
+    virtual ~Wire() = default;
+    virtual bool write(const uint8_t* buf, size_t len) = 0;
+    virtual bool flush() { return true; }
+    // 1 once bytes (or the end of the stream) are waiting, 0 at the
+    // deadline, -1 on error.
+    virtual int wait_readable(std::chrono::steady_clock::time_point deadline) = 0;
+    virtual bool read_exact(uint8_t* buf, size_t len, int timeout_ms) = 0;
+};
+
+// A connected TCP socket, closed with the wire.
+struct SocketWire : Wire {
+    SOCKET s;
+    explicit SocketWire(SOCKET sock) : s(sock) {}
+    ~SocketWire() override { closesocket(s); }
+    bool write(const uint8_t* buf, size_t len) override { return send_all(s, buf, len); }
+    int wait_readable(std::chrono::steady_clock::time_point deadline) override {
+        return llc::wait_readable(s, deadline);
+    }
+    bool read_exact(uint8_t* buf, size_t len, int timeout_ms) override { return recv_exact(s, buf, len, timeout_ms); }
+};
+
+// Emulated link stage in front of a wire. Frames wait in a min-heap keyed
+// on their release time and a delivery thread writes them out when due, so
+// the protocol thread never sleeps on the simulated link.
+struct DelayLine {
+    using clock = std::chrono::steady_clock;
+    struct Item {
+        clock::time_point when;
+        uint64_t order;
+        std::vector<uint8_t> bytes;
+    };
+
+    Wire& wire;
+    std::vector<Item> heap;
+    uint64_t order = 0;
+    std::mutex m;
+    std::condition_variable cv;
+    bool stop = false;
+    std::atomic<bool> failed{false};
+    std::thread worker;
+
+    explicit DelayLine(Wire& w) : wire(w), worker([this] { run(); }) {}
+    ~DelayLine() {
+        { std::lock_guard<std::mutex> lk(m); stop = true; }
+        cv.notify_one();
+        worker.join();
+    }
+
+    void push(clock::time_point when, std::vector<uint8_t> bytes) {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            heap.push_back({when, order++, std::move(bytes)});
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+        cv.notify_one();
+    }
+
+private:
+    static bool later(const Item& a, const Item& b) {
+        return a.when != b.when ? a.when > b.when : a.order > b.order;
+    }
+    void run() {
+        std::unique_lock<std::mutex> lk(m);
+        while (!stop) {
+            if (heap.empty()) { cv.wait(lk); continue; }
+            if (clock::now() < heap.front().when) { cv.wait_until(lk, heap.front().when); continue; }
+            std::pop_heap(heap.begin(), heap.end(), later);
+            std::vector<uint8_t> bytes = std::move(heap.back().bytes);
+            heap.pop_back();
+            bool more = !heap.empty() && heap.front().when <= clock::now();
+            lk.unlock();
+            if (!wire.write(bytes.data(), bytes.size()) || (!more && !wire.flush())) failed = true;
+            lk.lock();
+        }
+    }
+};
+
+// Simulated link impairments, applied by whichever side transmits.
+//
+// Bit errors use skip sampling: instead of one Bernoulli draw per bit, the
+// number of clean bits before the next error is drawn from a geometric
+// distribution, so the cost is proportional to the number of errors. With
+// p_gb > 0 the error rate follows a Gilbert-Elliott chain: the link sits in
+// a good state (error rate bit_error_prob) or a bad state (e_bad), and the
+// sojourn in each state is itself geometric in bits.
+//
+// Surviving frames go through a DelayLine: each is released after its
+// serialization time at rate_bps (frames queue behind each other), the
+// propagation delay prop_ms and a uniform jitter in [0, max_delay_ms].
+// Jitter alone keeps frames in order; a reordered frame is released
+// reorder_ms late and may be overtaken. Frames can also be duplicated.
+//
+// Every model draws from its own generator, so changing e.g. the reorder
+// rate does not perturb the bit-error pattern of an otherwise identical run.
+// Extra parameters come from configure(), normally fed from LLC_CHANNEL:
+//   LLC_CHANNEL="rate=1e6 prop_ms=20 p_gb=1e-5 p_bg=1e-2 e_bad=1e-2 reorder=0.01 seed=42"
+// Per-model seeds: seed.bits, seed.burst, seed.reorder, seed.delay.
+struct Channel {
+    double bit_error_prob = 0.0;
+    int max_delay_ms = 0;
+    double loss_prob = 0.0;
+
+    double p_gb = 0.0, p_bg = 0.0, e_bad = 0.0;
+    double reorder_prob = 0.0, dup_prob = 0.0;
+    double prop_ms = 0.0, rate_bps = 0.0, reorder_ms = 5.0;
+
+    std::mt19937_64 bit_rng{ std::random_device{}() };
+    std::mt19937_64 burst_rng{ std::random_device{}() };
+    std::mt19937_64 reorder_rng{ std::random_device{}() };
+    std::mt19937_64 delay_rng{ std::random_device{}() };
+    std::uniform_real_distribution<double> U{0.0, 1.0};
+
+    bool bad = false;
+    uint64_t state_left = 0;
+    std::unique_ptr<DelayLine> line{};
+    std::chrono::steady_clock::time_point link_free{}, last_release{};
+
+    // Release time of a frame entering the link now.
+    std::chrono::steady_clock::time_point schedule(size_t nbytes, bool late,
+                                                   std::chrono::steady_clock::time_point now) {
+        using us = std::chrono::microseconds;
+        double tx_us = rate_bps > 0.0 ? double(nbytes) * 8.0 * 1e6 / rate_bps : 0.0;
+        link_free = std::max(link_free, now) + us(int64_t(tx_us));
+        double jitter_ms = max_delay_ms > 0 ? U(delay_rng) * max_delay_ms : 0.0;
+        auto when = link_free + us(int64_t((prop_ms + jitter_ms) * 1000.0));
+        if (late) return when + us(int64_t(reorder_ms * 1000.0));
+        last_release = std::max(last_release, when);
+        return last_release;
+    }
+    bool maybe_drop() { return loss_prob > 0.0 && U(delay_rng) < loss_prob; }
+
+    // Clean bits before the next event of probability p.
+    uint64_t gap(std::mt19937_64& g, double p) {
+        if (p <= 0.0) return UINT64_MAX;
+        if (p >= 1.0) return 0;
+        double k = std::floor(std::log1p(-U(g)) / std::log1p(-p));
+        return k >= 1e18 ? UINT64_MAX : uint64_t(k);
+    }
+
+    void flip_bits(std::vector<uint8_t>& buf) {
+        if (bit_error_prob <= 0.0 && p_gb <= 0.0) return;
+        const uint64_t nbits = uint64_t(buf.size()) * 8;
+        uint64_t pos = 0;
+        while (pos < nbits) {
+            uint64_t run = nbits - pos;
+            if (p_gb > 0.0) {
+                if (state_left == 0) {
+                    uint64_t g = gap(burst_rng, bad ? p_bg : p_gb);
+                    state_left = g == UINT64_MAX ? g : g + 1;
+                }
+                run = std::min(run, state_left);
+            }
+            double e = bad ? e_bad : bit_error_prob;
+            for (uint64_t at = gap(bit_rng, e); at < run; ) {
+                uint64_t bit = pos + at;
+                buf[size_t(bit >> 3)] ^= uint8_t(1u << (bit & 7));
+                uint64_t g = gap(bit_rng, e);
+                if (g >= run) break;
+                at += g + 1;
+            }
+            pos += run;
+            if (p_gb > 0.0 && state_left != UINT64_MAX) {
+                state_left -= run;
+                if (state_left == 0) bad = !bad;
+            }
+        }
+    }
+
+    // Corrupts one frame entering the link at `now`, then drops, duplicates
+    // or reorders it; deliver(when, bytes) receives each surviving copy.
+    // Returns the number of copies (0 if dropped).
+    template <class Deliver>
+    int impair(std::vector<uint8_t> w, std::chrono::steady_clock::time_point now, Deliver&& deliver) {
+        flip_bits(w);
+        if (maybe_drop()) return 0;
+        int copies = (dup_prob > 0.0 && U(reorder_rng) < dup_prob) ? 2 : 1;
+        bool late = reorder_prob > 0.0 && U(reorder_rng) < reorder_prob;
+        const size_t n = w.size();
+        if (copies == 2) deliver(schedule(n, false, now), w);
+        auto when = schedule(n, late, now);
+        deliver(when, std::move(w));
+        return copies;
+    }
+
+    // impair() onto the delay line in front of `to`, or straight onto a
+    // direct wire when nothing delays frames. Returns -1 once the link has
+    // failed to send.
+    int transmit(Wire& to, std::vector<uint8_t> w) {
+        if (to.direct && immediate()) {
+            bool ok = true;
+            int r = impair(std::move(w), std::chrono::steady_clock::now(),
+                           [&](std::chrono::steady_clock::time_point, std::vector<uint8_t> b) {
+                               ok = to.write(b.data(), b.size()) && ok;
+                           });
+            return ok ? r : -1;
+        }
+        if (!line) line = std::make_unique<DelayLine>(to);
+        if (line->failed) return -1;
+        return impair(std::move(w), std::chrono::steady_clock::now(),
+                      [&](std::chrono::steady_clock::time_point when, std::vector<uint8_t> b) {
+                          line->push(when, std::move(b));
+                      });
+    }
+
+    // True if frames leave as soon as they are impaired: no delay, rate or
+    // reordering, so a caller may write them to the socket itself.
+    bool immediate() const {
+        return max_delay_ms <= 0 && prop_ms <= 0.0 && rate_bps <= 0.0 && reorder_prob <= 0.0;
+    }
+
+    // Takes the link down; frames still in flight are lost.
+    void close() { line.reset(); }
+
+    void configure(const char* spec, bool announce = true) {
+        if (!spec || !*spec) return;
+        std::string text(spec);
+        std::replace(text.begin(), text.end(), ',', ' ');
+        size_t i = 0;
+        while (i < text.size()) {
+            size_t end = text.find(' ', i);
+            if (end == std::string::npos) end = text.size();
+            std::string tok = text.substr(i, end - i);
+            i = end + 1;
+            size_t eq = tok.find('=');
+            if (tok.empty()) continue;
+            if (eq == std::string::npos) { std::cerr << "[CHANNEL] Ignoring '" << tok << "'\n"; continue; }
+            std::string key = tok.substr(0, eq);
+            double v = std::atof(tok.c_str() + eq + 1);
+            uint64_t sv = std::strtoull(tok.c_str() + eq + 1, nullptr, 10);
+            if (key == "p_gb") p_gb = v;
+            else if (key == "p_bg") p_bg = v;
+            else if (key == "e_bad") e_bad = v;
+            else if (key == "reorder") reorder_prob = v;
+            else if (key == "dup") dup_prob = v;
+            else if (key == "loss") loss_prob = v;
+            else if (key == "prop_ms") prop_ms = v;
+            else if (key == "rate") rate_bps = v;
+            else if (key == "jitter_ms") max_delay_ms = int(v);
+            else if (key == "reorder_ms") reorder_ms = v;
+            else if (key == "seed") {
+                bit_rng.seed(sv); burst_rng.seed(sv + 1); reorder_rng.seed(sv + 2); delay_rng.seed(sv + 3);
+            }
+            else if (key == "seed.bits") bit_rng.seed(sv);
+            else if (key == "seed.burst") burst_rng.seed(sv);
+            else if (key == "seed.reorder") reorder_rng.seed(sv);
+            else if (key == "seed.delay") delay_rng.seed(sv);
+            else std::cerr << "[CHANNEL] Unknown key '" << key << "'\n";
+        }
+        if (!announce) return;
+        std::cout << "[CHANNEL] rate=" << rate_bps << "bps prop=" << prop_ms << "ms jitter="
+                  << max_delay_ms << "ms p_err=" << bit_error_prob << " p_gb=" << p_gb << " p_bg=" << p_bg
+                  << " e_bad=" << e_bad << " reorder=" << reorder_prob << " dup=" << dup_prob
+                  << " loss=" << loss_prob << "\n";
+    }
+};
+
+// CRC-32 (IEEE 802.3, reflected) by slicing-by-8: eight table lookups
+// consume eight input bytes per step. The Copy variant also stores the bytes
+// it reads, so a frame is checksummed in the same pass that writes it out or
+// copies it in. Functions take and return the raw register; crc32() adds the
+// initial and final inversion.
+struct Crc32Tables {
+    uint32_t t[8][256];
+    Crc32Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int j = 0; j < 8; ++j)
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+            for (int k = 1; k < 8; ++k)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFFu];
+    }
+};
+inline const Crc32Tables& crc32_tables() {
+    static const Crc32Tables tables;
+    return tables;
+}
+
+template <bool Copy>
+inline uint32_t crc32_run(uint32_t c, uint8_t* dst, const uint8_t* src, size_t n) {
+    const auto& T = crc32_tables().t;
+    while (n >= 8) {
+        uint32_t lo = (uint32_t(src[0]) | (uint32_t(src[1]) << 8) | (uint32_t(src[2]) << 16) | (uint32_t(src[3]) << 24)) ^ c;
+        uint32_t hi = uint32_t(src[4]) | (uint32_t(src[5]) << 8) | (uint32_t(src[6]) << 16) | (uint32_t(src[7]) << 24);
+        if (Copy) { std::memcpy(dst, src, 8); dst += 8; }
+        c = T[7][lo & 0xFFu] ^ T[6][(lo >> 8) & 0xFFu] ^ T[5][(lo >> 16) & 0xFFu] ^ T[4][lo >> 24]
+          ^ T[3][hi & 0xFFu] ^ T[2][(hi >> 8) & 0xFFu] ^ T[1][(hi >> 16) & 0xFFu] ^ T[0][hi >> 24];
+        src += 8;
+        n -= 8;
+    }
+    for (; n > 0; --n, ++src) {
+        if (Copy) *dst++ = *src;
+        c = T[0][(c ^ *src) & 0xFFu] ^ (c >> 8);
+    }
+    return c;
+}
+inline uint32_t crc32_update(uint32_t c, const uint8_t* data, size_t len) {
+    return crc32_run<false>(c, nullptr, data, len);
+}
+inline uint32_t crc32_copy(uint32_t c, uint8_t* dst, const uint8_t* src, size_t len) {
+    return crc32_run<true>(c, dst, src, len);
+}
+inline uint32_t crc32(const uint8_t* data, size_t len) {
+    return crc32_update(0xFFFFFFFFu, data, len) ^ 0xFFFFFFFFu;
+}
+
+// Narrower checks for short compact frames (MSB first, no reflection):
+// CRC-8 0x07 keeps Hamming distance 4 up to 119 bits, CRC-16/CCITT (0x1021,
+// init 0xFFFF) up to 32751 bits.
+inline uint8_t crc8(const uint8_t* data, size_t len) {
+    uint8_t c = 0;
+    for (size_t i = 0; i < len; ++i) {
+        c ^= data[i];
+        for (int j = 0; j < 8; ++j) c = uint8_t((c & 0x80) ? (c << 1) ^ 0x07 : c << 1);
+    }
+    return c;
+}
+struct Crc16Table {
+    uint16_t t[256];
+    Crc16Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint16_t c = uint16_t(i << 8);
+            for (int j = 0; j < 8; ++j) c = uint16_t((c & 0x8000) ? (c << 1) ^ 0x1021 : c << 1);
+            t[i] = c;
+        }
+    }
+};
+inline uint16_t crc16(const uint8_t* data, size_t len) {
+    static const Crc16Table table;
+    uint16_t c = 0xFFFF;
+    for (size_t i = 0; i < len; ++i) c = uint16_t((c << 8) ^ table.t[(c >> 8) ^ data[i]]);
+    return c;
+}
+
+inline void store_be32(uint8_t* p, uint32_t v) {
+    p[0] = uint8_t(v >> 24); p[1] = uint8_t(v >> 16); p[2] = uint8_t(v >> 8); p[3] = uint8_t(v);
+}
+inline uint32_t load_be32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// Sender clock for timestamp echo: microseconds, wrapping at 32 bits, so
+// differences stay exact for runs shorter than ~71 minutes. The time is
+// passed in so that simulated runs stamp frames with virtual time.
+inline uint32_t timestamp_us(std::chrono::steady_clock::time_point t) {
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count());
+}
+inline double ms_since(uint32_t ts_us, std::chrono::steady_clock::time_point now) {
+    return double(uint32_t(timestamp_us(now) - ts_us)) / 1000.0;
+}
+
+static constexpr size_t MIN_PAYLOAD = 46;
+// Header: src(6) dst(6) len(2) seq(1) flags(1) stream(1) ts(4).
+static constexpr size_t HEADER_LEN = 21;
+static constexpr size_t MIN_FRAME = HEADER_LEN + MIN_PAYLOAD + 4;
+static constexpr size_t STREAM_OFF = 16;
+// Compact format, used once the receiver has agreed to it: flags(1) |
+// varint len | varint seq | stream(1, only if nonzero) | ts(4) | payload |
+// CRC of 1, 2 or 4 bytes. No addresses and no padding. The flags byte is
+// always odd and a MAC's first byte never is, which is how a receiver tells
+// the two formats apart.
+enum : uint8_t {
+    COMPACT_MARK = 0x01, COMPACT_FIN = 0x02, COMPACT_STREAM = 0x04, COMPACT_CRC16 = 0x08, COMPACT_CRC32 = 0x10,
+    COMPACT_RESERVED = 0xE0
+};
+static constexpr size_t COMPACT_MIN = 8;   // flags, len, seq, ts, CRC-8
+// The check widens with the bytes it covers: each width up to where it
+// still has Hamming distance 4, and CRC-32 once a frame is long enough to
+// take several errors at a time.
+static constexpr size_t COMPACT_CRC8_MAX = 14;
+static constexpr size_t COMPACT_CRC16_MAX = 256;
+
+inline bool is_compact(const uint8_t* buf, size_t len) { return len > 0 && (buf[0] & COMPACT_MARK); }
+
+// LEB128: seven bits per byte, low first, high bit set on all but the last.
+inline uint8_t* put_varint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) { *p++ = uint8_t(v | 0x80); v >>= 7; }
+    *p++ = uint8_t(v);
+    return p;
+}
+// False if the value runs past `len` or past two bytes (no compact field
+// needs more).
+inline bool get_varint(const uint8_t* buf, size_t len, size_t& i, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 14; shift += 7) {
+        if (i >= len) return false;
+        uint8_t b = buf[i++];
+        v |= uint32_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+inline size_t compact_crc_len(uint8_t flags) {
+    return (flags & COMPACT_CRC32) ? 4 : (flags & COMPACT_CRC16) ? 2 : 1;
+}
+// Bytes the compact frame at buf takes in all, judged from the `len` bytes
+// read so far: a lower bound while its header is incomplete, and `len`
+// itself if the header is malformed (the frame then fails its CRC).
+inline size_t compact_wire_len(const uint8_t* buf, size_t len) {
+    if (len == 0) return COMPACT_MIN;
+    uint8_t flags = buf[0];
+    if (flags & COMPACT_RESERVED) return len;
+    size_t i = 1;
+    uint32_t v[2];   // len, seq
+    for (uint32_t& x : v) {
+        size_t start = i;
+        if (!get_varint(buf, len, i, x)) return i - start < 2 ? std::max(len + 1, COMPACT_MIN) : len;
+    }
+    if (v[0] > 1500 || v[1] > 255) return len;
+    return i + ((flags & COMPACT_STREAM) ? 1 : 0) + 4 + v[0] + compact_crc_len(flags);
+}
+
+struct Frame {
+    uint8_t src[6]{};
+    uint8_t dst[6]{};
+    uint16_t length{0};
+    uint8_t seq{0};
+    uint8_t flags{0};
+    uint8_t stream{0};
+    uint32_t ts{0};
+    std::vector<uint8_t> payload;
+    uint32_t fcs{0};
+
+    // Header, payload and FCS written in one pass; the CRC is accumulated as
+    // the payload is copied into the output.
+    static std::vector<uint8_t> encode(const uint8_t src[6], const uint8_t dst[6], uint16_t length,
+                                       uint8_t seq, uint32_t ts, const uint8_t* payload, size_t n,
+                                       uint8_t flags = 0, uint8_t stream = 0) {
+        const size_t body = HEADER_LEN + std::max(n, MIN_PAYLOAD);
+        std::vector<uint8_t> out(body + 4);
+        uint8_t* p = out.data();
+        std::copy(src, src + 6, p);
+        std::copy(dst, dst + 6, p + 6);
+        uint16_t be_len = htons(length);
+        p[12] = uint8_t(be_len >> 8);
+        p[13] = uint8_t(be_len & 0xFF);
+        p[14] = seq;
+        p[15] = flags;
+        p[16] = stream;
+        store_be32(p + 17, ts);
+        uint32_t c = crc32_update(0xFFFFFFFFu, p, HEADER_LEN);
+        c = crc32_copy(c, p + HEADER_LEN, payload, n);
+        if (n < MIN_PAYLOAD) {
+            std::fill(p + HEADER_LEN + n, p + body, uint8_t(' '));
+            c = crc32_update(c, p + HEADER_LEN + n, MIN_PAYLOAD - n);
+        }
+        store_be32(p + body, c ^ 0xFFFFFFFFu);
+        return out;
+    }
+    static std::vector<uint8_t> encode_compact(uint8_t seq, uint32_t ts, const uint8_t* payload, size_t n,
+                                               uint8_t flags = 0, uint8_t stream = 0) {
+        uint8_t head[16];
+        uint8_t* h = put_varint(head + 1, uint32_t(n));
+        h = put_varint(h, seq);
+        head[0] = uint8_t(COMPACT_MARK | (flags & COMPACT_FIN));
+        if (stream) { head[0] |= COMPACT_STREAM; *h++ = stream; }
+        store_be32(h, ts);
+        h += 4;
+        size_t covered = size_t(h - head) + n;
+        if (covered > COMPACT_CRC16_MAX) head[0] |= COMPACT_CRC32;
+        else if (covered > COMPACT_CRC8_MAX) head[0] |= COMPACT_CRC16;
+        std::vector<uint8_t> out(covered + compact_crc_len(head[0]));
+        uint8_t* p = out.data();
+        std::copy(head, h, p);
+        if (n) std::memcpy(p + (h - head), payload, n);
+        put_compact_crc(p, covered);
+        return out;
+    }
+    static void put_compact_crc(uint8_t* p, size_t covered) {
+        if (p[0] & COMPACT_CRC32) {
+            store_be32(p + covered, crc32(p, covered));
+        } else if (p[0] & COMPACT_CRC16) {
+            uint16_t c = crc16(p, covered);
+            p[covered] = uint8_t(c >> 8);
+            p[covered + 1] = uint8_t(c);
+        } else {
+            p[covered] = crc8(p, covered);
+        }
+    }
+    // Rewrites the timestamp of a frame from encode() or encode_compact()
+    // and recomputes its CRC, so a resend needs no second look at the payload.
+    static void restamp(std::vector<uint8_t>& wire, uint32_t ts) {
+        uint8_t* p = wire.data();
+        if (!is_compact(p, wire.size())) {
+            store_be32(p + 17, ts);
+            store_be32(p + wire.size() - 4, crc32(p, wire.size() - 4));
+            return;
+        }
+        size_t i = 1;
+        uint32_t v = 0;
+        get_varint(p, wire.size(), i, v);
+        get_varint(p, wire.size(), i, v);
+        if (p[0] & COMPACT_STREAM) ++i;
+        store_be32(p + i, ts);
+        put_compact_crc(p, wire.size() - compact_crc_len(p[0]));
+    }
+    std::vector<uint8_t> serialize_with_crc() {
+        auto out = encode(src, dst, length, seq, ts, payload.data(), payload.size(), flags, stream);
+        fcs = load_be32(out.data() + out.size() - 4);
+        return out;
+    }
+    // Parses buf, copying the payload out and checking the FCS in the same
+    // pass. Returns false if buf is shorter than the frame it describes.
+    static bool parse(const std::vector<uint8_t>& buf, Frame& out, bool& crc_ok) {
+        crc_ok = false;
+        if (is_compact(buf.data(), buf.size())) return parse_compact(buf, out, crc_ok);
+        if (buf.size() < MIN_FRAME) return false;
+        std::copy(buf.begin(), buf.begin() + 6, out.src);
+        std::copy(buf.begin() + 6, buf.begin() + 12, out.dst);
+        uint16_t be_len = (uint16_t(buf[12]) << 8) | uint16_t(buf[13]);
+        out.length = ntohs(be_len);
+        out.seq = buf[14];
+        out.flags = buf[15];
+        out.stream = buf[16];
+        out.ts = load_be32(buf.data() + 17);
+        size_t header_payload = HEADER_LEN + std::max<size_t>(MIN_PAYLOAD, out.length);
+        if (buf.size() < header_payload + 4) return false;
+        out.payload.resize(header_payload - HEADER_LEN);
+        uint32_t c = crc32_update(0xFFFFFFFFu, buf.data(), HEADER_LEN);
+        c = crc32_copy(c, out.payload.data(), buf.data() + HEADER_LEN, out.payload.size());
+        out.fcs = load_be32(buf.data() + header_payload);
+        crc_ok = (c ^ 0xFFFFFFFFu) == out.fcs;
+        if (out.length < MIN_PAYLOAD) out.payload.resize(out.length);
+        return true;
+    }
+    // A malformed header (reserved flags, oversized fields) parses as a
+    // frame with a bad CRC rather than failing, so the receiver still
+    // counts and NAKs it.
+    static bool parse_compact(const std::vector<uint8_t>& buf, Frame& out, bool& crc_ok) {
+        const uint8_t* p = buf.data();
+        size_t total = compact_wire_len(p, buf.size());
+        if (total > buf.size()) return false;
+        out = Frame{};
+        if (total != buf.size() || total < COMPACT_MIN) return true;
+        size_t i = 1;
+        uint32_t n = 0, seq = 0;
+        get_varint(p, total, i, n);
+        get_varint(p, total, i, seq);
+        out.length = uint16_t(n);
+        out.seq = uint8_t(seq);
+        out.flags = p[0] & COMPACT_FIN;
+        if (p[0] & COMPACT_STREAM) out.stream = p[i++];
+        out.ts = load_be32(p + i);
+        i += 4;
+        out.payload.assign(p + i, p + i + n);
+        size_t covered = i + n;
+        if (p[0] & COMPACT_CRC32) {
+            out.fcs = load_be32(p + covered);
+            crc_ok = crc32(p, covered) == out.fcs;
+        } else if (p[0] & COMPACT_CRC16) {
+            out.fcs = (uint32_t(p[covered]) << 8) | p[covered + 1];
+            crc_ok = crc16(p, covered) == out.fcs;
+        } else {
+            out.fcs = p[covered];
+            crc_ok = crc8(p, covered) == out.fcs;
+        }
+        return true;
+    }
+    // Stream ID of a data frame in either format; 0 if it cannot be read.
+    static uint8_t stream_of(const std::vector<uint8_t>& buf) {
+        if (!is_compact(buf.data(), buf.size())) return buf.size() > STREAM_OFF ? buf[STREAM_OFF] : 0;
+        if (!(buf[0] & COMPACT_STREAM)) return 0;
+        size_t i = 1;
+        uint32_t v = 0;
+        if (!get_varint(buf.data(), buf.size(), i, v) || !get_varint(buf.data(), buf.size(), i, v)) return 0;
+        return i < buf.size() ? buf[i] : 0;
+    }
+};
+
+enum : uint8_t { FRAME_AGGREGATE = 0x01, FRAME_FIN = 0x02 };
+static_assert(int(COMPACT_FIN) == int(FRAME_FIN), "compact frames carry FIN in the same bit");
+
+// Payload bytes owned elsewhere, plus the header flags to send them with.
+struct Chunk {
+    const uint8_t* data;
+    size_t size;
+    uint8_t flags;
+};
+
+// Aggregate of consecutive frames seq, seq+1, ... behind one header with
+// FRAME_AGGREGATE set. The body is a subframe count, then per subframe
+// len(2) | payload | crc32(4), each CRC covering its len and payload. The
+// trailing FCS covers only the header and count, so a bit error costs one
+// subframe instead of the whole aggregate, and the receiver still knows
+// which seqs to NAK when a corrupted len misaligns the rest.
+struct Superframe {
+    static constexpr size_t SUB_OVERHEAD = 6;
+    struct Sub {
+        uint8_t seq;
+        bool ok;
+        std::vector<uint8_t> payload;
+    };
+
+    static std::vector<uint8_t> encode(const uint8_t src[6], const uint8_t dst[6], uint8_t stream, uint8_t seq,
+                                       uint32_t ts, const std::vector<Chunk>& parts) {
+        size_t body = 1;
+        for (const Chunk& c : parts) body += SUB_OVERHEAD + c.size;
+        const size_t padded = std::max(body, MIN_PAYLOAD);
+        std::vector<uint8_t> out(HEADER_LEN + padded + 4);
+        uint8_t* p = out.data();
+        std::copy(src, src + 6, p);
+        std::copy(dst, dst + 6, p + 6);
+        uint16_t be_len = htons(uint16_t(body));
+        p[12] = uint8_t(be_len >> 8);
+        p[13] = uint8_t(be_len & 0xFF);
+        p[14] = seq;
+        p[15] = FRAME_AGGREGATE;
+        p[16] = stream;
+        store_be32(p + 17, ts);
+        p[HEADER_LEN] = uint8_t(parts.size());
+        store_be32(p + HEADER_LEN + padded, crc32(p, HEADER_LEN + 1));
+        uint8_t* w = p + HEADER_LEN + 1;
+        for (const Chunk& part : parts) {
+            w[0] = uint8_t(part.size >> 8);
+            w[1] = uint8_t(part.size & 0xFF);
+            uint32_t c = crc32_update(0xFFFFFFFFu, w, 2);
+            c = crc32_copy(c, w + 2, part.data, part.size);
+            store_be32(w + 2 + part.size, c ^ 0xFFFFFFFFu);
+            w += SUB_OVERHEAD + part.size;
+        }
+        return out;
+    }
+
+    // False if the header or count is corrupted; otherwise one Sub per seq
+    // the header announces, ok=false for those that failed their CRC.
+    static bool parse(const std::vector<uint8_t>& buf, Frame& hdr, std::vector<Sub>& subs) {
+        subs.clear();
+        if (buf.size() < MIN_FRAME) return false;
+        uint16_t be_len = (uint16_t(buf[12]) << 8) | uint16_t(buf[13]);
+        hdr.length = ntohs(be_len);
+        size_t padded = std::max<size_t>(MIN_PAYLOAD, hdr.length);
+        if (buf.size() < HEADER_LEN + padded + 4) return false;
+        if (load_be32(buf.data() + HEADER_LEN + padded) != crc32(buf.data(), HEADER_LEN + 1)) return false;
+        std::copy(buf.begin(), buf.begin() + 6, hdr.src);
+        std::copy(buf.begin() + 6, buf.begin() + 12, hdr.dst);
+        hdr.seq = buf[14];
+        hdr.flags = buf[15];
+        hdr.stream = buf[16];
+        hdr.ts = load_be32(buf.data() + 17);
+        size_t count = buf[HEADER_LEN];
+        const uint8_t* r = buf.data() + HEADER_LEN + 1;
+        const uint8_t* end = buf.data() + HEADER_LEN + std::min<size_t>(hdr.length, padded);
+        for (size_t i = 0; i < count; ++i) {
+            Sub s{uint8_t(hdr.seq + i), false, {}};
+            size_t n = (end - r >= 2) ? (size_t(r[0]) << 8 | r[1]) : 0;
+            if (end - r >= ptrdiff_t(SUB_OVERHEAD + n)) {
+                s.payload.resize(n);
+                uint32_t c = crc32_update(0xFFFFFFFFu, r, 2);
+                c = crc32_copy(c, s.payload.data(), r + 2, n);
+                s.ok = (c ^ 0xFFFFFFFFu) == load_be32(r + 2 + n);
+                r += SUB_OVERHEAD + n;
+            } else {
+                r = end;
+            }
+            subs.push_back(std::move(s));
+        }
+        return true;
+    }
+};
+
+enum : uint8_t { ACK = 0x06, NAK = 0x15, SACK = 0x13 };
+// Set in the type byte of every ACK, NAK and SACK from a receiver that
+// takes compact frames; a sender that may use them switches on seeing it.
+static constexpr uint8_t TAKES_COMPACT = 0x80;
+// ts echoes the timestamp of the data frame that triggered the ACK. win is
+// the receiver's advertised window: how many frames past its lowest missing
+// seq it will take (255 = no limit of its own).
+// Wire: type, stream, seq, ts, win, crc32.
+struct Ack {
+    static constexpr size_t WIRE = 12;
+    uint8_t type{ACK};
+    uint8_t seq{0};
+    uint32_t ts{0};
+    uint8_t stream{0};
+    uint8_t win{255};
+    uint32_t fcs{0};
+    bool compact{false};
+    std::vector<uint8_t> serialize() {
+        std::vector<uint8_t> b{uint8_t(type | (compact ? TAKES_COMPACT : 0)), stream, seq,
+                               uint8_t((ts >> 24) & 0xFF), uint8_t((ts >> 16) & 0xFF),
+                               uint8_t((ts >> 8) & 0xFF), uint8_t(ts & 0xFF), win};
+        uint32_t c = crc32(b.data(), b.size());
+        fcs = c;
+        b.push_back(uint8_t((c >> 24) & 0xFF));
+        b.push_back(uint8_t((c >> 16) & 0xFF));
+        b.push_back(uint8_t((c >> 8) & 0xFF));
+        b.push_back(uint8_t(c & 0xFF));
+        return b;
+    }
+    static bool parse(const uint8_t* buf, size_t len, Ack& out) {
+        if (len < WIRE) return false;
+        uint32_t got = load_be32(buf + 8);
+        if (got != crc32(buf, 8)) return false;
+        out.type = buf[0] & ~TAKES_COMPACT;
+        out.compact = (buf[0] & TAKES_COMPACT) != 0;
+        out.stream = buf[1];
+        out.seq = buf[2];
+        out.ts = load_be32(buf + 3);
+        out.win = buf[7];
+        out.fcs = got;
+        return true;
+    }
+};
+
+// Selective ACK: every seq before `base` has arrived; bit i of the bitmap
+// reports base + i (SR windows are at most 128 wide). ts echoes the frame
+// echo_seq, the one that triggered this SACK. win as in Ack, from base.
+// parity_rows is the HARQ NAK's count for parity_seq (0 = none asked for).
+// Wire: type, stream, base, echo_seq, ts, win, parity_seq, parity_rows,
+// bitmap[16], crc32.
+struct Sack {
+    static constexpr size_t BITMAP = 16;
+    static constexpr size_t BODY = 11 + BITMAP;
+    static constexpr size_t WIRE = BODY + 4;
+    uint8_t type{SACK};
+    uint8_t stream{0};
+    uint8_t base{0};
+    uint8_t echo_seq{0};
+    uint32_t ts{0};
+    uint8_t win{255};
+    uint8_t parity_seq{0};
+    uint8_t parity_rows{0};
+    uint8_t bitmap[BITMAP]{};
+    uint32_t fcs{0};
+    bool compact{false};
+
+    void mark(int off) { bitmap[off >> 3] |= uint8_t(1u << (off & 7)); }
+    bool has(int off) const { return (bitmap[off >> 3] >> (off & 7)) & 1u; }
+
+    std::vector<uint8_t> serialize() {
+        std::vector<uint8_t> b(BODY);
+        b[0] = uint8_t(type | (compact ? TAKES_COMPACT : 0)); b[1] = stream; b[2] = base; b[3] = echo_seq;
+        store_be32(b.data() + 4, ts);
+        b[8] = win;
+        b[9] = parity_seq;
+        b[10] = parity_rows;
+        std::copy(bitmap, bitmap + BITMAP, b.begin() + 11);
+        uint32_t c = crc32(b.data(), b.size());
+        fcs = c;
+        b.push_back(uint8_t((c >> 24) & 0xFF));
+        b.push_back(uint8_t((c >> 16) & 0xFF));
+        b.push_back(uint8_t((c >> 8) & 0xFF));
+        b.push_back(uint8_t(c & 0xFF));
+        return b;
+    }
+    static bool parse(const uint8_t* buf, size_t len, Sack& out) {
+        if (len < WIRE || (buf[0] & ~TAKES_COMPACT) != SACK) return false;
+        uint32_t got = (uint32_t(buf[BODY]) << 24) | (uint32_t(buf[BODY + 1]) << 16)
+                     | (uint32_t(buf[BODY + 2]) << 8) | uint32_t(buf[BODY + 3]);
+        if (got != crc32(buf, BODY)) return false;
+        out.type = SACK;
+        out.compact = (buf[0] & TAKES_COMPACT) != 0;
+        out.stream = buf[1];
+        out.base = buf[2];
+        out.echo_seq = buf[3];
+        out.ts = load_be32(buf + 4);
+        out.win = buf[8];
+        out.parity_seq = buf[9];
+        out.parity_rows = buf[10];
+        std::copy(buf + 11, buf + BODY, out.bitmap);
+        out.fcs = got;
+        return true;
+    }
+};
+
+inline void random_mac(uint8_t mac[6]) {
+    static std::mt19937 rng{ std::random_device{}() };
+    std::uniform_int_distribution<int> D(0, 255);
+    for (int i = 0; i < 6; ++i) mac[i] = uint8_t(D(rng));
+    mac[0] &= 0xFE;
+    mac[0] |= 0x02;
+}
+
+// Cumulative-ACK coalescing: ack after `every` in-order frames or `delay_ms`
+// after the first unacknowledged one, whichever comes first. Anything that
+// is not the next in-order frame should be acked at once by the caller.
+struct AckPolicy {
+    using clock = std::chrono::steady_clock;
+    int every = 1;
+    int delay_ms = 0;
+    int unacked = 0;
+    clock::time_point deadline = clock::time_point::max();
+
+    bool on_in_order(clock::time_point now) {
+        ++unacked;
+        if (unacked >= every || delay_ms <= 0) return true;
+        if (unacked == 1) deadline = now + std::chrono::milliseconds(delay_ms);
+        return false;
+    }
+    bool due(clock::time_point now) const { return unacked > 0 && now >= deadline; }
+    void sent() { unacked = 0; deadline = clock::time_point::max(); }
+};
+
+// The receiver's advertised window as a sender tracks it. While the window
+// is shut with nothing in flight, the persist timer runs; each time it fires
+// the sender may put one frame past the window as a probe, whose ACK carries
+// the current window, so a lost window update cannot stall the transfer.
+// The probe interval starts at the RTO and doubles up to 4 s.
+struct PeerWindow {
+    using clock = std::chrono::steady_clock;
+    int win = 255;
+    double probe_ms = 0.0;
+    clock::time_point persist = clock::time_point::max();
+
+    // True if the advertised window changed.
+    bool update(uint8_t w) {
+        if (w == win) return false;
+        win = w;
+        if (win > 0) stop();
+        return true;
+    }
+    // Starts the persist timer unless it is already running.
+    void hold(clock::time_point now, double rto_ms) {
+        if (persist != clock::time_point::max()) return;
+        if (probe_ms <= 0.0) probe_ms = rto_ms;
+        persist = now + std::chrono::microseconds(int64_t(probe_ms * 1000.0));
+    }
+    bool probe_due(clock::time_point now) {
+        if (now < persist) return false;
+        persist = clock::time_point::max();
+        probe_ms = std::min(4000.0, probe_ms * 2.0);
+        return true;
+    }
+    void stop() {
+        persist = clock::time_point::max();
+        probe_ms = 0.0;
+    }
+};
+
+struct RttEstimator {
+    bool have = false;
+    double srtt = 0.0, rttvar = 0.0;
+    double rto_ms = 1000.0;
+    void observe(double sample_ms) {
+        if (!have) {
+            srtt = sample_ms;
+            rttvar = sample_ms / 2.0;
+            have = true;
+        } else {
+            const double alpha = 1.0 / 8.0;
+            const double beta  = 1.0 / 4.0;
+            rttvar = (1.0 - beta) * rttvar + beta * std::abs(srtt - sample_ms);
+            srtt   = (1.0 - alpha) * srtt   + alpha * sample_ms;
+        }
+        rto_ms = clampd(srtt + 4.0 * rttvar, 200.0, 4000.0);
+    }
+};
+
+} // namespace llc
@@ -0,0 +1,240 @@
+#pragma once
+#include "llc_arq.h"
+
+namespace llc {
+
+// Flags the last payload FIN, as a file transfer already does, so the peer
+// knows when this direction of a full-duplex session is complete.
+struct FinMarked : PayloadSource {
+    const PayloadSource& inner;
+    explicit FinMarked(const PayloadSource& p) : inner(p) {}
+    size_t size() const override { return inner.size(); }
+    Chunk at(size_t i) const override {
+        Chunk c = inner.at(i);
+        if (i + 1 == inner.size()) c.flags |= FRAME_FIN;
+        return c;
+    }
+};
+
+// Every record on a duplex wire, data frame with trailer or standalone
+// ACK, goes behind a 3-byte prefix: its length (big-endian) and a CRC-8 of
+// that. The prefix passes through the channel with the record, and over its
+// 24 bits the CRC has Hamming distance 4, so a single flipped bit is found
+// and corrected: the reader keeps its framing even when the frame inside
+// fails its own check. A length of Ack::WIRE marks a standalone ACK.
+struct RecordPrefix {
+    static constexpr size_t WIRE = 3;
+
+    static void put(std::vector<uint8_t>& record) {
+        uint8_t p[WIRE] = {uint8_t(record.size() >> 8), uint8_t(record.size())};
+        p[2] = crc8(p, 2);
+        record.insert(record.begin(), p, p + WIRE);
+    }
+
+    // The record length, or 0 if two or more bits of the prefix flipped.
+    static size_t get(const uint8_t* p) {
+        uint8_t t[WIRE] = {p[0], p[1], p[2]};
+        if (crc8(t, 2) == t[2]) return (size_t(t[0]) << 8) | t[1];
+        for (size_t bit = 0; bit < WIRE * 8; ++bit) {
+            uint8_t mask = uint8_t(0x80 >> (bit % 8));
+            t[bit / 8] ^= mask;
+            if (crc8(t, 2) == t[2]) return (size_t(t[0]) << 8) | t[1];
+            t[bit / 8] ^= mask;
+        }
+        return 0;
+    }
+};
+
+// Full-duplex Go-Back-N over one connection: each end runs a sender and a
+// receiver. Every data frame leaves with a 12-byte Ack trailer after its FCS
+// holding the receiver's latest cumulative ACK (type 0 if there is none), so
+// in a two-way transfer most acknowledgements need no frame of their own.
+// The trailer is attached as the frame goes out, so a resent frame carries
+// a current ACK. An ACK not taken by a data frame within hold goes out
+// alone, as does one that would wait for data this end no longer has, or
+// that already covers a quarter of the window (both ends use the same N) so
+// the peer never stalls on it. NAKs, duplicate ACKs (which fast retransmit
+// counts) and every ACK after the peer's FIN are never held.
+struct DuplexEndpoint : ArqMachine {
+    struct TxLink : ArqLink {
+        DuplexEndpoint& ep;
+        explicit TxLink(DuplexEndpoint& e) : ep(e) { out = e.link.out; }
+        clock::time_point now() override { return ep.link.now(); }
+        int send(std::vector<uint8_t> wire) override { return ep.send_data(std::move(wire)); }
+    };
+    struct RxLink : ArqLink {
+        DuplexEndpoint& ep;
+        explicit RxLink(DuplexEndpoint& e) : ep(e) { out = e.link.out; }
+        clock::time_point now() override { return ep.link.now(); }
+        int send(std::vector<uint8_t> wire) override { return ep.send_ack(std::move(wire)); }
+    };
+    // Sees the peer's FIN go by on its way to the real sink.
+    struct FinWatch : PayloadSink {
+        DuplexEndpoint& ep;
+        bool seen = false;
+        explicit FinWatch(DuplexEndpoint& e) : ep(e) {}
+        void consume(std::vector<uint8_t>& payload, uint8_t flags) override {
+            if (flags & FRAME_FIN) seen = true;
+            if (ep.sink) ep.sink->consume(payload, flags);
+        }
+        size_t room() const override { return ep.sink ? ep.sink->room() : SIZE_MAX; }
+    };
+
+    TxLink txl;
+    RxLink rxl;
+    FinWatch fin;
+    FinMarked source;
+    GbnSender tx;
+    GbnReceiver rx;
+    clock::duration hold;
+    std::vector<uint8_t> held;      // ACK waiting for a data frame
+    clock::time_point hold_until = clock::time_point::max();
+    std::vector<uint8_t> no_ack;    // trailer when nothing is held
+    std::vector<uint8_t> frame, trailer;
+    bool acked_any = false;
+    uint8_t last_ack = 0;
+    int superseded = 0;             // ACKs folded into the held one
+    uint64_t piggybacked = 0, standalone = 0;
+
+    DuplexEndpoint(ArqLink& l, const PayloadSource& p, int n, const std::string& cc_kind, int hold_ms)
+        : ArqMachine(l), txl(*this), rxl(*this), fin(*this), source(p), tx(txl, source, n, cc_kind),
+          rx(rxl, AckPolicy{}), hold(std::chrono::milliseconds(std::max(0, hold_ms))) {
+        rx.sink = &fin;
+        no_ack = Ack{0, 0, 0, stream}.serialize();
+    }
+
+    // Both directions delivered; the driver still lingers for the peer.
+    bool done() const override { return tx.done() && fin.seen && held.empty(); }
+
+    clock::time_point next_wakeup() override {
+        return std::min({tx.next_wakeup(), rx.next_wakeup(), hold_until});
+    }
+
+    void start() override { tx.start(); }
+
+    int send_data(std::vector<uint8_t> wire) {
+        if (held.empty()) {
+            wire.insert(wire.end(), no_ack.begin(), no_ack.end());
+        } else {
+            wire.insert(wire.end(), held.begin(), held.end());
+            held.clear();
+            hold_until = clock::time_point::max();
+            ++piggybacked;
+        }
+        return send_record(std::move(wire));
+    }
+
+    int send_record(std::vector<uint8_t> wire) {
+        RecordPrefix::put(wire);
+        return send(std::move(wire));
+    }
+
+    int send_ack(std::vector<uint8_t> wire) {
+        Ack a{};
+        Ack::parse(wire.data(), wire.size(), a);
+        superseded = held.empty() ? 0 : superseded + 1;
+        bool urgent = hold.count() == 0 || a.type != ACK || (acked_any && a.seq == last_ack) || fin.seen ||
+                      superseded >= std::max(2, tx.frame_cache.span / 4);
+        acked_any = true;
+        last_ack = a.seq;
+        if (!urgent) {
+            held = std::move(wire);
+            if (hold_until == clock::time_point::max()) hold_until = now() + hold;
+            return 1;
+        }
+        held.clear();
+        hold_until = clock::time_point::max();
+        ++standalone;
+        return send_record(std::move(wire));
+    }
+
+    // After each event: a held ACK goes out alone once its hold is over, or
+    // at once if nothing is left to send that could carry it.
+    void settle() {
+        if (held.empty()) return;
+        bool due = now() >= hold_until;
+        bool drained = tx.idx >= source.size() && tx.nextseq == tx.hiseq;
+        if (!due && !drained) return;
+        if (due) log() << "[DUPLEX] No data frame within hold, ACK sent alone\n";
+        hold_until = clock::time_point::max();
+        ++standalone;
+        send_record(std::move(held));
+        held.clear();
+    }
+
+    // A standalone ACK is exactly Ack::WIRE long; anything longer is a data
+    // frame with its trailer. The data goes first so that the sender, acting
+    // on the trailer, can carry the ACK it produced.
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        if (buf.size() <= Ack::WIRE) {
+            tx.on_frame(buf);
+            settle();
+            return;
+        }
+        size_t n = buf.size() - Ack::WIRE;
+        frame.assign(buf.begin(), buf.begin() + ptrdiff_t(n));
+        trailer.assign(buf.begin() + ptrdiff_t(n), buf.end());
+        rx.on_frame(frame);
+        Ack a{};
+        if (!Ack::parse(trailer.data(), trailer.size(), a) || a.type != 0) tx.on_frame(trailer);
+        settle();
+    }
+
+    void on_tick() override {
+        auto t = now();
+        if (tx.next_wakeup() <= t) tx.on_tick();
+        if (rx.next_wakeup() <= t) rx.on_tick();
+        settle();
+    }
+};
+
+// Both directions on one wire, as RecordPrefix records. A prefix too
+// damaged to correct, or naming an impossible length, leaves no way to find
+// the next record, so the connection is given up. Once both directions are
+// complete it lingers for two RTOs after the last frame heard, so a FIN the
+// peer resends is still acknowledged, and returns at once if the peer
+// closes first.
+inline bool run_duplex(Wire& w, DuplexEndpoint& m, const char* tag, int max_delay) {
+    using clock = std::chrono::steady_clock;
+    const int tail_timeout = std::max(1000, 5 * max_delay + 500);
+    auto quiet_until = clock::time_point::max();
+    auto linger = [&] {
+        auto ms = std::max(1000.0, 2.0 * m.tx.rtt.rto_ms);
+        return clock::now() + std::chrono::microseconds(int64_t(ms * 1000.0));
+    };
+    std::vector<uint8_t> buf;
+    m.start();
+    while (!m.failed) {
+        if (m.done()) {
+            if (quiet_until == clock::time_point::max()) quiet_until = linger();
+            if (clock::now() >= quiet_until) return true;
+        }
+        int ready = w.wait_readable(std::min({m.next_wakeup(), quiet_until, m.sink_due()}));
+        if (ready < 0) { std::cerr << "select() failed\n"; return false; }
+        if (clock::now() >= m.sink_due()) m.poll_sink();
+        if (ready > 0) {
+            uint8_t prefix[RecordPrefix::WIRE];
+            if (!w.read_exact(prefix, RecordPrefix::WIRE, 4000)) {
+                if (m.done()) return true;
+                std::cerr << tag << " Connection lost.\n";
+                return false;
+            }
+            size_t len = RecordPrefix::get(prefix);
+            if (len < Ack::WIRE || len > HEADER_LEN + 1500 + 4 + Ack::WIRE) {
+                std::cerr << tag << " Record framing lost.\n";
+                return false;
+            }
+            buf.resize(len);
+            if (!w.read_exact(buf.data(), len, tail_timeout)) {
+                std::cout << tag << " Incomplete frame.\n";
+                continue;
+            }
+            m.on_frame(buf);
+            if (m.done()) quiet_until = linger();
+        }
+        m.on_tick();
+    }
+    return false;
+}
+
+} // namespace llc
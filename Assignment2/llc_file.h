@@ -0,0 +1,316 @@
+#pragma once
+#include "llc_arq.h"
+#include "llc_spsc.h"
+
+namespace llc {
+
+// Binary file mode. The file is cut into CHUNK-sized payloads on demand from
+// read-only views of a file mapping, followed by one FRAME_FIN payload
+// carrying the file size and CRC-32. A view is a multiple of both CHUNK and
+// the 64 KiB mapping granularity, so no chunk straddles two; only the two
+// newest views stay mapped, which covers any window (at most 255 frames).
+struct FileSource : PayloadSource {
+    static constexpr size_t CHUNK = 1500;
+    static constexpr size_t PER_VIEW = 16384;
+    static constexpr uint64_t VIEW = uint64_t(CHUNK) * PER_VIEW;
+    static constexpr size_t FIN_LEN = 12;
+
+    struct View {
+        uint64_t index = 0;
+        const uint8_t* base = nullptr;
+    };
+
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    uint64_t bytes = 0;
+    size_t chunks = 0;
+    mutable View views[2];
+    // The digest is accumulated the first time each chunk is handed out,
+    // which senders do in order; the FIN chunk completes it if needed.
+    mutable size_t digested = 0;
+    mutable uint32_t crc = 0xFFFFFFFFu;
+    mutable uint8_t fin[FIN_LEN]{};
+
+    FileSource() = default;
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    ~FileSource() {
+        for (auto& v : views) {
+            if (v.base) UnmapViewOfFile(v.base);
+        }
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    }
+
+    bool open(const char* path) {
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) return false;
+        bytes = uint64_t(size.QuadPart);
+        chunks = size_t((bytes + CHUNK - 1) / CHUNK);
+        if (bytes == 0) return true;   // empty files cannot be mapped
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        return mapping != nullptr;
+    }
+
+    size_t size() const override { return chunks + 1; }
+
+    Chunk at(size_t i) const override {
+        if (i == chunks) {
+            while (digested < chunks) at(digested);
+            store_be32(fin, uint32_t(bytes >> 32));
+            store_be32(fin + 4, uint32_t(bytes));
+            store_be32(fin + 8, crc ^ 0xFFFFFFFFu);
+            return {fin, FIN_LEN, FRAME_FIN};
+        }
+        const uint8_t* p = view(i / PER_VIEW) + (i % PER_VIEW) * CHUNK;
+        size_t n = size_t(std::min<uint64_t>(CHUNK, bytes - uint64_t(i) * CHUNK));
+        if (i == digested) {
+            crc = crc32_update(crc, p, n);
+            ++digested;
+        }
+        return {p, n, 0};
+    }
+
+private:
+    const uint8_t* view(uint64_t index) const {
+        for (auto& v : views) {
+            if (v.base && v.index == index) return v.base;
+        }
+        View& v = !views[0].base ? views[0]
+                : !views[1].base ? views[1]
+                : (views[0].index < views[1].index ? views[0] : views[1]);
+        if (v.base) UnmapViewOfFile(v.base);
+        uint64_t off = index * VIEW;
+        size_t len = size_t(std::min<uint64_t>(VIEW, bytes - off));
+        v.base = static_cast<const uint8_t*>(
+            MapViewOfFile(mapping, FILE_MAP_READ, DWORD(off >> 32), DWORD(off & 0xFFFFFFFFu), len));
+        v.index = index;
+        if (!v.base) { std::cerr << "MapViewOfFile failed at offset " << off << "\n"; std::exit(1); }
+        return v.base;
+    }
+};
+
+// Writes delivered payloads to disk without ever blocking the receive loop:
+// payloads are appended to a batch, and full batches (or the last one, on
+// FIN) go through an SPSC ring to a writer thread that issues one large
+// WriteFile per batch. Spent buffers come back on a second ring for reuse;
+// if the writer falls behind, the current batch just keeps growing, and
+// room() closes the receiver's advertised window once it is far behind.
+// fsync_ms > 0 flushes to stable storage at most that often while data is
+// arriving; the file is always flushed on close. After the FIN the file is
+// read back and checked against the sender's size and CRC-32.
+struct FileSink : PayloadSink {
+    static constexpr size_t BATCH = size_t(1) << 20;
+    static constexpr size_t MAX_BACKLOG = 16 * BATCH;
+    using clock = std::chrono::steady_clock;
+
+    std::string path;
+    HANDLE file = INVALID_HANDLE_VALUE;
+    int fsync_ms = 0;
+    std::vector<uint8_t> batch;
+    clock::time_point batch_started{};
+    SpscRing<std::vector<uint8_t>> full{64};
+    SpscRing<std::vector<uint8_t>> spare{64};
+    std::thread writer;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> write_failed{false};
+    std::atomic<uint64_t> written{0};
+    uint64_t batches = 0, syncs = 0;
+
+    uint64_t bytes = 0;
+    uint32_t crc = 0xFFFFFFFFu;
+    bool finished = false;
+    bool ok = false;
+    bool closed = false;
+    bool disk_ok = false;
+    uint64_t expect_bytes = 0;
+    uint32_t expect_crc = 0;
+
+    FileSink() = default;
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+    ~FileSink() { close(); }
+
+    bool open(const char* p, int sync_ms) {
+        path = p;
+        fsync_ms = std::max(0, sync_ms);
+        file = CreateFileA(p, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                           nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        batch.reserve(BATCH);
+        writer = std::thread([this] { write_loop(); });
+        return true;
+    }
+
+    void consume(std::vector<uint8_t>& payload, uint8_t flags) override {
+        if (finished) return;
+        if (flags & FRAME_FIN) {
+            finished = true;
+            if (payload.size() >= FileSource::FIN_LEN) {
+                expect_bytes = (uint64_t(load_be32(payload.data())) << 32) | load_be32(payload.data() + 4);
+                expect_crc = load_be32(payload.data() + 8);
+                ok = expect_bytes == bytes && expect_crc == (crc ^ 0xFFFFFFFFu);
+            }
+            close();
+            return;
+        }
+        if (batch.empty()) batch_started = clock::now();
+        batch.insert(batch.end(), payload.begin(), payload.end());
+        crc = crc32_update(crc, payload.data(), payload.size());
+        bytes += payload.size();
+        bool stale = fsync_ms > 0 && clock::now() - batch_started >= std::chrono::milliseconds(fsync_ms);
+        if (batch.size() >= BATCH || stale) hand_off();
+    }
+
+    // A batch older than fsync_ms goes to the writer even while no payload
+    // arrives to trigger it, e.g. while the sender waits out an RTO. One the
+    // writer cannot take yet is retried a period later.
+    clock::time_point due() const override {
+        if (fsync_ms == 0 || batch.empty() || closed) return clock::time_point::max();
+        return batch_started + std::chrono::milliseconds(fsync_ms);
+    }
+    void poll() override {
+        if (clock::now() < due()) return;
+        hand_off();
+        if (!batch.empty()) batch_started = clock::now();
+    }
+
+    // Bytes consumed but not yet written; past MAX_BACKLOG the receiver's
+    // advertised window shuts until the writer catches up.
+    size_t room() const override {
+        uint64_t backlog = bytes - written.load(std::memory_order_acquire);
+        return backlog < MAX_BACKLOG ? size_t(MAX_BACKLOG - backlog) : 0;
+    }
+
+    // Passes the current batch to the writer unless its ring is full, in
+    // which case the batch stays here and grows.
+    void hand_off() {
+        if (batch.empty()) return;
+        if (!full.try_push(std::move(batch))) return;
+        ++batches;
+        if (!spare.try_pop(batch)) batch = {};
+        batch.clear();
+        if (batch.capacity() < BATCH) batch.reserve(BATCH);
+    }
+
+    void write_loop() {
+        Backoff idle;
+        auto last_sync = clock::now();
+        bool dirty = false;
+        std::vector<uint8_t> buf;
+        while (true) {
+            // Read before polling, so a batch queued ahead of the stop
+            // request is still seen.
+            bool stop = stopping.load(std::memory_order_acquire);
+            if (full.try_pop(buf)) {
+                idle.reset();
+                size_t off = 0;
+                while (off < buf.size() && !write_failed) {
+                    DWORD n = DWORD(std::min<size_t>(buf.size() - off, size_t(1) << 30));
+                    DWORD done = 0;
+                    if (!WriteFile(file, buf.data() + off, n, &done, nullptr) || done == 0) write_failed = true;
+                    off += done;
+                }
+                written += off;
+                dirty = true;
+                buf.clear();
+                spare.try_push(std::move(buf));
+                buf = {};
+            } else if (stop) {
+                break;
+            } else {
+                idle.wait();
+            }
+            if (dirty && fsync_ms > 0 && clock::now() - last_sync >= std::chrono::milliseconds(fsync_ms)) {
+                FlushFileBuffers(file);
+                ++syncs;
+                last_sync = clock::now();
+                dirty = false;
+            }
+        }
+    }
+
+    void close() {
+        if (closed) return;
+        closed = true;
+        if (file == INVALID_HANDLE_VALUE) return;
+        while (!batch.empty()) {
+            hand_off();
+            if (!batch.empty()) std::this_thread::yield();
+        }
+        stopping.store(true, std::memory_order_release);
+        writer.join();
+        FlushFileBuffers(file);
+        ++syncs;
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+        if (finished) disk_ok = !write_failed && written == bytes && verify_on_disk();
+    }
+
+    // Reads the file back: size and CRC-32 must match what the sender
+    // announced.
+    bool verify_on_disk() const {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> buf(BATCH);
+        uint32_t c = 0xFFFFFFFFu;
+        uint64_t n = 0;
+        while (in) {
+            in.read(buf.data(), std::streamsize(buf.size()));
+            std::streamsize got = in.gcount();
+            if (got <= 0) break;
+            c = crc32_update(c, reinterpret_cast<const uint8_t*>(buf.data()), size_t(got));
+            n += uint64_t(got);
+        }
+        return n == expect_bytes && (c ^ 0xFFFFFFFFu) == expect_crc;
+    }
+
+    void report(const char* tag) {
+        close();
+        std::cout << tag << " File: " << bytes << " bytes, CRC-32 " << std::hex << (crc ^ 0xFFFFFFFFu) << std::dec;
+        if (!finished) std::cout << " INCOMPLETE (no FIN)\n";
+        else if (!ok) std::cout << " MISMATCH (sender: " << expect_bytes << " bytes, CRC-32 " << std::hex
+                                << expect_crc << std::dec << ")\n";
+        else if (!disk_ok) std::cout << " OK in memory, but the file on disk does not match"
+                                     << (write_failed ? " (write failed)" : "") << "\n";
+        else std::cout << " OK, verified on disk (" << batches << " writes, " << syncs << " fsyncs)\n";
+    }
+};
+
+// LLC_SEND_FILE selects binary file mode; otherwise one payload per line of
+// data.txt.
+inline std::unique_ptr<PayloadSource> open_payloads(const char* tag) {
+    if (const char* path = std::getenv("LLC_SEND_FILE")) {
+        auto f = std::make_unique<FileSource>();
+        if (!f->open(path)) { std::cerr << "Cannot open " << path << "\n"; return nullptr; }
+        std::cout << tag << " Sending " << path << " (" << f->bytes << " bytes, " << f->chunks
+                  << " chunks + FIN)\n";
+        return f;
+    }
+    auto p = std::make_unique<Payloads>();
+    if (!read_payloads("data.txt", *p) || p->lines.empty()) { std::cerr << "No data in data.txt\n"; return nullptr; }
+    return p;
+}
+
+// LLC_RECV_FILE names where a binary transfer is reassembled; unset, the
+// receiver only acknowledges. Streams of a multiplexed session write to
+// <path>.<stream>. LLC_FSYNC=<ms> sets the flush cadence.
+inline std::unique_ptr<FileSink> open_sink(const char* tag, int stream = -1) {
+    const char* env = std::getenv("LLC_RECV_FILE");
+    if (!env) return nullptr;
+    std::string path = env;
+    if (stream >= 0) path += "." + std::to_string(stream);
+    auto s = std::make_unique<FileSink>();
+    const char* fsync_env = std::getenv("LLC_FSYNC");
+    if (!s->open(path.c_str(), fsync_env ? std::atoi(fsync_env) : 0)) {
+        std::cerr << "Cannot create " << path << "\n";
+        std::exit(1);
+    }
+    std::cout << tag << " Writing to " << path << "\n";
+    return s;
+}
+
+} // namespace llc
@@ -0,0 +1,341 @@
+#pragma once
+#include "llc_common.h"
+
+namespace llc {
+
+enum : uint8_t { FRAME_HARQ = 0x04, FRAME_PARITY = 0x08 };
+
+// GF(2^8) over x^8 + x^4 + x^3 + x^2 + 1.
+struct Gf256 {
+    uint8_t exp[512];
+    uint8_t log[256];
+    Gf256() {
+        unsigned x = 1;
+        for (int i = 0; i < 255; ++i) {
+            exp[i] = exp[i + 255] = uint8_t(x);
+            log[x] = uint8_t(i);
+            x <<= 1;
+            if (x & 0x100) x ^= 0x11D;
+        }
+        exp[510] = exp[511] = exp[0];
+        log[0] = 0;
+    }
+    uint8_t mul(uint8_t a, uint8_t b) const { return a && b ? exp[log[a] + log[b]] : 0; }
+    uint8_t inv(uint8_t a) const { return exp[255 - log[a]]; }
+    // dst ^= c * src over n bytes.
+    void mul_add(uint8_t* dst, const uint8_t* src, uint8_t c, size_t n) const {
+        if (!c) return;
+        const unsigned lc = log[c];
+        for (size_t i = 0; i < n; ++i) {
+            if (src[i]) dst[i] ^= exp[log[src[i]] + lc];
+        }
+    }
+};
+
+inline const Gf256& gf256() {
+    static const Gf256 g;
+    return g;
+}
+
+// Type-II hybrid ARQ coding of one payload. The payload is cut into up to
+// MAX_BLOCKS blocks (the last zero-padded), each sent with its own CRC-32,
+// so a bit error erases one block instead of the frame. Parity row r is
+// sum_j C(r, j) * D_j with Cauchy coefficients C(r, j) = 1 / (x_r + y_j),
+// x_r = blocks + r and y_j = j: any k intact rows rebuild any k erased
+// blocks. Row 0 rides along with the data; NAKs ask for further rows.
+//
+// Data frame (FRAME_HARQ): len(2) | payload crc32(4) | blocks x (block |
+// crc32) | row 0 (block | crc32). Parity frame (FRAME_HARQ|FRAME_PARITY):
+// len(2) | row(1) | block | crc32. As with superframes, the trailing FCS
+// covers only the header and the fixed prefix.
+struct Harq {
+    static constexpr size_t MAX_BLOCKS = 8;
+    static constexpr size_t MIN_BLOCK = 32;
+    static constexpr size_t DATA_PREFIX = 6;
+    static constexpr size_t PARITY_PREFIX = 3;
+
+    size_t len, blocks, block;
+
+    explicit Harq(size_t n)
+        : len(n),
+          blocks(std::min(MAX_BLOCKS, std::max<size_t>(1, (n + MIN_BLOCK - 1) / MIN_BLOCK))),
+          block(std::max<size_t>(1, (n + blocks - 1) / blocks)) {}
+
+    // Rows a sender offers before falling back to resending the frame.
+    size_t rows() const { return blocks; }
+    size_t unit() const { return block + 4; }
+
+    uint8_t coef(size_t row, size_t j) const { return gf256().inv(uint8_t((blocks + row) ^ j)); }
+
+    // Block j of the payload, zero-padded to `block` bytes.
+    void data_block(const uint8_t* payload, size_t j, uint8_t* out) const {
+        size_t off = std::min(len, j * block);
+        size_t n = std::min(block, len - off);
+        std::copy(payload + off, payload + off + n, out);
+        std::fill(out + n, out + block, uint8_t(0));
+    }
+
+    void parity_block(const uint8_t* payload, size_t row, uint8_t* out) const {
+        std::fill(out, out + block, uint8_t(0));
+        for (size_t j = 0; j < blocks; ++j) {
+            size_t off = std::min(len, j * block);
+            size_t n = std::min(block, len - off);
+            gf256().mul_add(out, payload + off, coef(row, j), n);
+        }
+    }
+
+    static void write_header(uint8_t* p, const uint8_t src[6], const uint8_t dst[6], size_t body, uint8_t seq,
+                             uint8_t flags, uint8_t stream, uint32_t ts) {
+        std::copy(src, src + 6, p);
+        std::copy(dst, dst + 6, p + 6);
+        uint16_t be_len = htons(uint16_t(body));
+        p[12] = uint8_t(be_len >> 8);
+        p[13] = uint8_t(be_len & 0xFF);
+        p[14] = seq;
+        p[15] = flags;
+        p[16] = stream;
+        store_be32(p + 17, ts);
+    }
+
+    static void seal(uint8_t* u, size_t n) { store_be32(u + n, crc32(u, n)); }
+
+    static std::vector<uint8_t> encode(const uint8_t src[6], const uint8_t dst[6], uint8_t stream, uint8_t seq,
+                                       uint32_t ts, const Chunk& c) {
+        Harq h(c.size);
+        const size_t body = DATA_PREFIX + (h.blocks + 1) * h.unit();
+        const size_t padded = std::max(body, MIN_PAYLOAD);
+        std::vector<uint8_t> out(HEADER_LEN + padded + 4);
+        uint8_t* p = out.data();
+        write_header(p, src, dst, body, seq, uint8_t(FRAME_HARQ | c.flags), stream, ts);
+        p[HEADER_LEN] = uint8_t(c.size >> 8);
+        p[HEADER_LEN + 1] = uint8_t(c.size & 0xFF);
+        store_be32(p + HEADER_LEN + 2, crc32(c.data, c.size));
+        uint8_t* u = p + HEADER_LEN + DATA_PREFIX;
+        for (size_t j = 0; j < h.blocks; ++j, u += h.unit()) {
+            h.data_block(c.data, j, u);
+            seal(u, h.block);
+        }
+        h.parity_block(c.data, 0, u);
+        seal(u, h.block);
+        store_be32(p + HEADER_LEN + padded, crc32(p, HEADER_LEN + DATA_PREFIX));
+        return out;
+    }
+
+    static std::vector<uint8_t> parity(const uint8_t src[6], const uint8_t dst[6], uint8_t stream, uint8_t seq,
+                                       uint32_t ts, const Chunk& c, uint8_t row) {
+        Harq h(c.size);
+        const size_t body = PARITY_PREFIX + h.unit();
+        const size_t padded = std::max(body, MIN_PAYLOAD);
+        std::vector<uint8_t> out(HEADER_LEN + padded + 4);
+        uint8_t* p = out.data();
+        write_header(p, src, dst, body, seq, uint8_t(FRAME_HARQ | FRAME_PARITY), stream, ts);
+        p[HEADER_LEN] = uint8_t(c.size >> 8);
+        p[HEADER_LEN + 1] = uint8_t(c.size & 0xFF);
+        p[HEADER_LEN + 2] = row;
+        uint8_t* u = p + HEADER_LEN + PARITY_PREFIX;
+        h.parity_block(c.data, row, u);
+        seal(u, h.block);
+        store_be32(p + HEADER_LEN + padded, crc32(p, HEADER_LEN + PARITY_PREFIX));
+        return out;
+    }
+
+    // What one HARQ frame carries: payload length and CRC (data frames), and
+    // raw units (block | crc32, unchecked) numbered 0..blocks-1 for data and
+    // blocks + r for parity row r.
+    struct Piece {
+        size_t len = 0;
+        uint32_t crc = 0;
+        bool parity = false;
+        std::vector<std::pair<size_t, const uint8_t*>> units;
+    };
+
+    // False if the header or prefix is corrupted or the length is
+    // inconsistent with the frame.
+    static bool parse(const std::vector<uint8_t>& buf, Frame& hdr, Piece& piece) {
+        piece.units.clear();
+        if (buf.size() < MIN_FRAME) return false;
+        uint16_t be_len = (uint16_t(buf[12]) << 8) | uint16_t(buf[13]);
+        hdr.length = ntohs(be_len);
+        size_t padded = std::max<size_t>(MIN_PAYLOAD, hdr.length);
+        if (buf.size() < HEADER_LEN + padded + 4) return false;
+        hdr.flags = buf[15];
+        piece.parity = (hdr.flags & FRAME_PARITY) != 0;
+        size_t prefix = piece.parity ? PARITY_PREFIX : DATA_PREFIX;
+        if (load_be32(buf.data() + HEADER_LEN + padded) != crc32(buf.data(), HEADER_LEN + prefix)) return false;
+        hdr.seq = buf[14];
+        hdr.stream = buf[16];
+        hdr.ts = load_be32(buf.data() + 17);
+        const uint8_t* r = buf.data() + HEADER_LEN;
+        piece.len = size_t(r[0]) << 8 | r[1];
+        Harq h(piece.len);
+        r += prefix;
+        if (piece.parity) {
+            size_t row = buf[HEADER_LEN + 2];
+            if (row >= 256 - h.blocks || hdr.length != PARITY_PREFIX + h.unit()) return false;
+            piece.units.push_back({h.blocks + row, r});
+        } else {
+            if (hdr.length != DATA_PREFIX + (h.blocks + 1) * h.unit()) return false;
+            piece.crc = load_be32(buf.data() + HEADER_LEN + 2);
+            for (size_t j = 0; j <= h.blocks; ++j, r += h.unit()) piece.units.push_back({j, r});
+        }
+        return true;
+    }
+};
+
+// Receiver state for one seq: every unit seen so far. A unit that fails
+// its CRC is kept, and once two or more damaged copies exist they are
+// combined: a bitwise majority vote, then every flip of the bits the
+// copies disagree on (up to FLIP_BITS of them) until one passes its CRC.
+// When intact data blocks plus intact parity rows cover the payload, the
+// erased blocks are solved for and the payload CRC confirms the result.
+struct HarqAssembly {
+    static constexpr size_t MAX_COPIES = 5;
+    static constexpr size_t FLIP_BITS = 12;
+
+    struct Unit {
+        bool ok = false;
+        std::vector<uint8_t> good;
+        std::vector<std::vector<uint8_t>> copies;
+    };
+
+    bool active = false;
+    uint8_t flags = 0;
+    uint32_t crc = 0;
+    Harq code{0};
+    std::vector<Unit> units;
+    uint64_t combined = 0;   // units recovered by combining damaged copies
+    uint64_t repaired = 0;   // data blocks rebuilt from parity
+
+    void reset() {
+        active = false;
+        units.clear();
+    }
+
+    void start(size_t len, uint32_t payload_crc, uint8_t frame_flags) {
+        active = true;
+        flags = frame_flags;
+        crc = payload_crc;
+        code = Harq(len);
+        units.assign(code.blocks + code.rows(), Unit{});
+    }
+
+    void add(size_t index, const uint8_t* raw) {
+        if (index >= units.size()) return;
+        Unit& u = units[index];
+        if (u.ok) return;
+        const size_t n = code.block;
+        if (crc32(raw, n) == load_be32(raw + n)) {
+            u.ok = true;
+            u.good.assign(raw, raw + n);
+            u.copies.clear();
+            return;
+        }
+        if (u.copies.size() < MAX_COPIES) u.copies.emplace_back(raw, raw + code.unit());
+        if (u.copies.size() >= 2 && combine(u)) ++combined;
+    }
+
+    bool combine(Unit& u) const {
+        const size_t n = code.unit();
+        const size_t votes = u.copies.size();
+        std::vector<uint8_t> best(n);
+        std::vector<size_t> unsure;
+        for (size_t i = 0; i < n; ++i) {
+            for (int b = 0; b < 8; ++b) {
+                size_t ones = 0;
+                for (auto& c : u.copies) ones += (c[i] >> b) & 1u;
+                bool bit = 2 * ones > votes || (2 * ones == votes && ((u.copies[0][i] >> b) & 1u));
+                if (bit) best[i] |= uint8_t(1u << b);
+                if (ones != 0 && ones != votes) unsure.push_back(i * 8 + size_t(b));
+            }
+        }
+        if (unsure.size() > FLIP_BITS) unsure.resize(0);
+        const size_t tries = size_t(1) << unsure.size();
+        for (size_t mask = 0; mask < tries; ++mask) {
+            std::vector<uint8_t> cand = best;
+            for (size_t k = 0; k < unsure.size(); ++k) {
+                if (mask >> k & 1u) cand[unsure[k] / 8] ^= uint8_t(1u << (unsure[k] % 8));
+            }
+            if (crc32(cand.data(), code.block) == load_be32(cand.data() + code.block)) {
+                u.ok = true;
+                u.good.assign(cand.begin(), cand.begin() + code.block);
+                u.copies.clear();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Parity rows still needed to rebuild the payload (0 once it can be).
+    size_t missing() const {
+        size_t erased = 0, rows = 0;
+        for (size_t j = 0; j < code.blocks; ++j) erased += !units[j].ok;
+        for (size_t r = code.blocks; r < units.size(); ++r) rows += units[r].ok;
+        return erased > rows ? erased - rows : 0;
+    }
+
+    // Rebuilds the payload into out. False if too much is missing or the
+    // result fails the payload CRC.
+    bool decode(std::vector<uint8_t>& out) {
+        const Gf256& gf = gf256();
+        const size_t B = code.blocks, S = code.block;
+        std::vector<size_t> erased, rows;
+        for (size_t j = 0; j < B; ++j) {
+            if (!units[j].ok) erased.push_back(j);
+        }
+        for (size_t r = B; r < units.size() && rows.size() < erased.size(); ++r) {
+            if (units[r].ok) rows.push_back(r - B);
+        }
+        if (rows.size() < erased.size()) return false;
+
+        const size_t k = erased.size();
+        if (k) {
+            // rhs_i = P_i - sum over intact blocks; then solve A x = rhs for
+            // the erased blocks by Gauss-Jordan elimination.
+            std::vector<std::vector<uint8_t>> a(k, std::vector<uint8_t>(k)), rhs(k);
+            for (size_t i = 0; i < k; ++i) {
+                rhs[i] = units[B + rows[i]].good;
+                for (size_t j = 0; j < B; ++j) {
+                    if (units[j].ok) gf.mul_add(rhs[i].data(), units[j].good.data(), code.coef(rows[i], j), S);
+                }
+                for (size_t m = 0; m < k; ++m) a[i][m] = code.coef(rows[i], erased[m]);
+            }
+            std::vector<uint8_t> tmp(S);
+            for (size_t col = 0; col < k; ++col) {
+                size_t piv = col;
+                while (piv < k && !a[piv][col]) ++piv;
+                if (piv == k) return false;
+                std::swap(a[piv], a[col]);
+                std::swap(rhs[piv], rhs[col]);
+                uint8_t inv = gf.inv(a[col][col]);
+                for (size_t m = 0; m < k; ++m) a[col][m] = gf.mul(a[col][m], inv);
+                std::fill(tmp.begin(), tmp.end(), uint8_t(0));
+                gf.mul_add(tmp.data(), rhs[col].data(), inv, S);
+                rhs[col] = tmp;
+                for (size_t i = 0; i < k; ++i) {
+                    uint8_t f = a[i][col];
+                    if (i == col || !f) continue;
+                    for (size_t m = 0; m < k; ++m) a[i][m] ^= gf.mul(f, a[col][m]);
+                    gf.mul_add(rhs[i].data(), rhs[col].data(), f, S);
+                }
+            }
+            for (size_t m = 0; m < k; ++m) {
+                units[erased[m]].good = std::move(rhs[m]);
+                units[erased[m]].ok = true;
+            }
+            repaired += k;
+        }
+
+        out.resize(code.len);
+        for (size_t j = 0; j < B; ++j) {
+            size_t off = std::min(code.len, j * S);
+            size_t n = std::min(S, code.len - off);
+            std::copy(units[j].good.begin(), units[j].good.begin() + n, out.begin() + off);
+        }
+        if (crc32(out.data(), out.size()) == crc) return true;
+        // A block that passed its CRC by chance, or a bad solve: start over.
+        for (size_t j = 0; j < B; ++j) units[j].ok = false;
+        return false;
+    }
+};
+
+} // namespace llc
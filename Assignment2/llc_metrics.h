@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace llc {
+
+// Log-linear histogram in the style of HdrHistogram. Values (microseconds)
+// fall into power-of-two ranges, each split into SUB/2 linear buckets, so
+// every value is kept to within 2/SUB relative error in fixed memory.
+// Values from 0 to 2^40 us (about 12 days) are tracked; larger ones clamp.
+struct HdrHistogram {
+    static constexpr int SUB_BITS = 7;
+    static constexpr uint64_t SUB = uint64_t(1) << SUB_BITS;
+    static constexpr uint64_t HALF = SUB / 2;
+    static constexpr int MAX_BITS = 40;
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>((MAX_BITS - SUB_BITS + 3) * HALF);
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+    double sum = 0.0;
+
+    static size_t index(uint64_t v) {
+        if (v < SUB) return size_t(v);
+        int msb = 63;
+        while (!(v >> msb)) --msb;
+        int r = msb - SUB_BITS + 1;
+        return size_t(uint64_t(r) * HALF + (v >> r));
+    }
+    static uint64_t highest(size_t i) {
+        if (i < SUB) return i;
+        uint64_t r = i / HALF - 1;
+        uint64_t s = i - r * HALF;
+        return ((s + 1) << r) - 1;
+    }
+
+    void record(uint64_t us) {
+        us = std::min(us, (uint64_t(1) << MAX_BITS) - 1);
+        ++counts[index(us)];
+        ++total;
+        max_value = std::max(max_value, us);
+        sum += double(us);
+    }
+
+    // Highest value equivalent to the q-quantile's bucket, as HDR reports it.
+    uint64_t percentile(double q) const {
+        if (total == 0) return 0;
+        uint64_t target = std::max<uint64_t>(1, uint64_t(std::ceil(q * double(total))));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= target) return std::min(highest(i), max_value);
+        }
+        return max_value;
+    }
+    double mean() const { return total ? sum / double(total) : 0.0; }
+
+    void merge(const HdrHistogram& o) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += o.counts[i];
+        total += o.total;
+        max_value = std::max(max_value, o.max_value);
+        sum += o.sum;
+    }
+};
+
+// Counters every protocol machine keeps. transmissions/delivered on the
+// machine itself stay the headline numbers; these break them down.
+struct Metrics {
+    using clock = std::chrono::steady_clock;
+    uint64_t frames_sent = 0;       // first transmissions of data frames
+    uint64_t retx_timeout = 0;
+    uint64_t retx_nak = 0;          // NAK, SACK hole or corrupted ACK
+    uint64_t duplicates = 0;        // receiver: frames it already had
+    uint64_t crc_failures = 0;      // receiver: data frames, sender: control frames
+    uint64_t wire_bytes = 0;        // every data frame put on the link
+    uint64_t first_wire_bytes = 0;  // first transmissions only
+    uint64_t payload_bytes = 0;     // payload acknowledged (sender) or delivered (receiver)
+    HdrHistogram rtt_us;            // Karn-valid RTT samples
+    HdrHistogram latency_us;        // first transmission to acknowledgement
+
+    // A data frame carrying `fresh` payloads on their first transmission
+    // (0 for a retransmission, several for an aggregate).
+    void sent(size_t bytes, size_t fresh) {
+        wire_bytes += bytes;
+        if (fresh) { frames_sent += fresh; first_wire_bytes += bytes; }
+    }
+    void rtt(double ms) { rtt_us.record(uint64_t(std::max(0.0, ms) * 1000.0)); }
+    void latency(clock::duration d) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        latency_us.record(uint64_t(std::max<int64_t>(0, us)));
+    }
+
+    void merge(const Metrics& o) {
+        frames_sent += o.frames_sent;
+        retx_timeout += o.retx_timeout;
+        retx_nak += o.retx_nak;
+        duplicates += o.duplicates;
+        crc_failures += o.crc_failures;
+        wire_bytes += o.wire_bytes;
+        first_wire_bytes += o.first_wire_bytes;
+        payload_bytes += o.payload_bytes;
+        rtt_us.merge(o.rtt_us);
+        latency_us.merge(o.latency_us);
+    }
+};
+
+// Textbook link efficiency for frame error probability P and a = one-way
+// propagation time / frame time:
+//   Stop&Wait (1-P)/(1+2a)
+//   Go-Back-N (1-P)/(1+2aP) if N >= 1+2a, else N(1-P)/((1+2a)(1-P+NP))
+//   SR        (1-P)         if N >= 1+2a, else N(1-P)/(1+2a)
+inline double analytic_efficiency(const std::string& proto, int N, double P, double a) {
+    const double w = 1.0 + 2.0 * a;
+    if (proto == "sw") return (1.0 - P) / w;
+    if (proto == "gbn") {
+        return N >= w ? (1.0 - P) / (1.0 + 2.0 * a * P) : N * (1.0 - P) / (w * (1.0 - P + N * P));
+    }
+    return N >= w ? 1.0 - P : N * (1.0 - P) / w;
+}
+
+// One run as written to LLC_METRICS. Rate-dependent figures are negative
+// when the link rate is unknown.
+struct RunSummary {
+    std::string program, protocol;
+    int N = 1;
+    double p_err = 0.0;
+    double rate_bps = 0.0;
+    double one_way_ms = 0.0;
+    double seconds = 0.0;
+    uint64_t transmissions = 0;
+    uint64_t delivered = 0;
+    const Metrics* m = nullptr;
+
+    double goodput_bps() const { return seconds > 0 ? 8.0 * double(m->payload_bytes) / seconds : 0.0; }
+    double utilization() const {
+        return rate_bps > 0 && seconds > 0 ? 8.0 * double(m->wire_bytes) / (rate_bps * seconds) : -1.0;
+    }
+    double efficiency() const {
+        return rate_bps > 0 && seconds > 0 ? 8.0 * double(m->first_wire_bytes) / (rate_bps * seconds) : -1.0;
+    }
+    double analytic() const {
+        if (rate_bps <= 0 || m->frames_sent == 0) return -1.0;
+        double bits = 8.0 * double(m->first_wire_bytes) / double(m->frames_sent);
+        double P = 1.0 - std::pow(1.0 - p_err, bits);
+        double a = (one_way_ms / 1000.0) / (bits / rate_bps);
+        return analytic_efficiency(protocol, N, P, a);
+    }
+};
+
+// JSON unless the path ends in .csv; CSV files get a header when new, so
+// several runs can append to one file.
+inline bool write_metrics(const std::string& path, const RunSummary& r) {
+    const Metrics& m = *r.m;
+    auto ms = [](uint64_t us) { return double(us) / 1000.0; };
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        bool fresh = !std::ifstream(path).good();
+        std::ofstream out(path, std::ios::app);
+        if (!out) return false;
+        if (fresh) {
+            out << "program,protocol,N,p_err,rate_bps,one_way_ms,seconds,transmissions,delivered,frames_sent,"
+                   "retx_timeout,retx_nak,duplicates,crc_failures,wire_bytes,payload_bytes,goodput_bps,"
+                   "utilization,efficiency,analytic_efficiency,rtt_samples,rtt_p50_ms,rtt_p99_ms,rtt_max_ms,"
+                   "latency_samples,latency_p50_ms,latency_p99_ms,latency_max_ms\n";
+        }
+        out << r.program << "," << r.protocol << "," << r.N << "," << r.p_err << "," << r.rate_bps << ","
+            << r.one_way_ms << "," << r.seconds << "," << r.transmissions << "," << r.delivered << ","
+            << m.frames_sent << "," << m.retx_timeout << "," << m.retx_nak << "," << m.duplicates << ","
+            << m.crc_failures << "," << m.wire_bytes << "," << m.payload_bytes << "," << r.goodput_bps() << ","
+            << r.utilization() << "," << r.efficiency() << "," << r.analytic() << "," << m.rtt_us.total << ","
+            << ms(m.rtt_us.percentile(0.5)) << "," << ms(m.rtt_us.percentile(0.99)) << ","
+            << ms(m.rtt_us.max_value) << "," << m.latency_us.total << "," << ms(m.latency_us.percentile(0.5))
+            << "," << ms(m.latency_us.percentile(0.99)) << "," << ms(m.latency_us.max_value) << "\n";
+        return bool(out);
+    }
+    std::ofstream out(path);
+    if (!out) return false;
+    auto hist = [&](const HdrHistogram& h) {
+        out << "{\"samples\": " << h.total << ", \"mean_ms\": " << h.mean() / 1000.0
+            << ", \"p50_ms\": " << ms(h.percentile(0.5)) << ", \"p90_ms\": " << ms(h.percentile(0.9))
+            << ", \"p99_ms\": " << ms(h.percentile(0.99)) << ", \"max_ms\": " << ms(h.max_value) << "}";
+    };
+    out << "{\n"
+        << "  \"program\": \"" << r.program << "\",\n"
+        << "  \"protocol\": \"" << r.protocol << "\",\n"
+        << "  \"N\": " << r.N << ",\n"
+        << "  \"p_err\": " << r.p_err << ",\n"
+        << "  \"rate_bps\": " << r.rate_bps << ",\n"
+        << "  \"one_way_ms\": " << r.one_way_ms << ",\n"
+        << "  \"seconds\": " << r.seconds << ",\n"
+        << "  \"transmissions\": " << r.transmissions << ",\n"
+        << "  \"delivered\": " << r.delivered << ",\n"
+        << "  \"frames_sent\": " << m.frames_sent << ",\n"
+        << "  \"retransmissions\": {\"timeout\": " << m.retx_timeout << ", \"nak\": " << m.retx_nak << "},\n"
+        << "  \"duplicates\": " << m.duplicates << ",\n"
+        << "  \"crc_failures\": " << m.crc_failures << ",\n"
+        << "  \"wire_bytes\": " << m.wire_bytes << ",\n"
+        << "  \"payload_bytes\": " << m.payload_bytes << ",\n"
+        << "  \"goodput_bps\": " << r.goodput_bps() << ",\n"
+        << "  \"utilization\": " << r.utilization() << ",\n"
+        << "  \"efficiency\": " << r.efficiency() << ",\n"
+        << "  \"analytic_efficiency\": " << r.analytic() << ",\n"
+        << "  \"rtt\": ";
+    hist(m.rtt_us);
+    out << ",\n  \"latency\": ";
+    hist(m.latency_us);
+    out << "\n}\n";
+    return bool(out);
+}
+
+} // namespace llc
@@ -0,0 +1,217 @@
+#pragma once
+#include "llc_arq.h"
+#include <deque>
+
+namespace llc {
+
+// Several Selective Repeat streams over one link. Every stream has its own
+// window, sequence space and timers, so a loss stalls only its own stream.
+// Frames a stream releases wait in that stream's queue; deficit round-robin
+// picks which queue feeds the link next, paced at the link rate if known.
+struct MuxSender : ArqMachine {
+    // One frame of the largest size always fits a fresh quantum, so each
+    // visit to a backlogged queue sends at least one frame.
+    static constexpr size_t QUANTUM = HEADER_LEN + 1500 + 4;
+
+    struct Queue : ArqLink {
+        ArqLink& real;
+        std::deque<std::vector<uint8_t>> frames;
+        size_t deficit = 0;
+        explicit Queue(ArqLink& l) : real(l) { out = &null_log(); }
+        clock::time_point now() override { return real.now(); }
+        int send(std::vector<uint8_t> wire) override {
+            frames.push_back(std::move(wire));
+            return 1;
+        }
+    };
+
+    struct Stream {
+        std::unique_ptr<PayloadSource> payloads;
+        std::unique_ptr<Queue> queue;
+        std::unique_ptr<SrSender> arq;
+        bool reported = false;
+    };
+
+    std::vector<Stream> streams;
+    double rate_bps;
+    size_t rr = 0;
+    bool fresh = true;   // streams[rr] not yet credited this round
+    clock::time_point t_start{}, link_free{};
+
+    MuxSender(ArqLink& l, double rate) : ArqMachine(l), rate_bps(rate) {}
+
+    void add(std::unique_ptr<PayloadSource> p, int n, const std::string& cc_kind) {
+        Stream s;
+        s.payloads = std::move(p);
+        s.queue = std::make_unique<Queue>(link);
+        s.arq = std::make_unique<SrSender>(*s.queue, *s.payloads, n, cc_kind);
+        s.arq->stream = uint8_t(streams.size());
+        streams.push_back(std::move(s));
+    }
+
+    bool done() const override {
+        for (auto& s : streams) {
+            if (!s.arq->done() || !s.queue->frames.empty()) return false;
+        }
+        return true;
+    }
+
+    clock::time_point next_wakeup() override {
+        auto wake = clock::time_point::max();
+        bool backlog = false;
+        for (auto& s : streams) {
+            wake = std::min(wake, s.arq->next_wakeup());
+            backlog |= !s.queue->frames.empty();
+        }
+        return backlog ? std::min(wake, link_free) : wake;
+    }
+
+    size_t control_len(uint8_t type) const override {
+        size_t n = Ack::WIRE;
+        for (auto& s : streams) n = std::max(n, s.arq->control_len(type));
+        return n;
+    }
+
+    void start() override {
+        t_start = link_free = now();
+        for (auto& s : streams) s.arq->start();
+        drain();
+    }
+
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        if (buf.size() > 1 && buf[1] < streams.size()) streams[buf[1]].arq->on_frame(buf);
+        drain();
+    }
+
+    void on_tick() override {
+        auto t = now();
+        for (auto& s : streams) {
+            if (s.arq->next_wakeup() <= t) s.arq->on_tick();
+        }
+        drain();
+    }
+
+    void next_queue() {
+        rr = (rr + 1) % streams.size();
+        fresh = true;
+    }
+
+    void drain() {
+        size_t idle = 0;
+        while (!failed && !streams.empty() && idle < streams.size()) {
+            Queue& q = *streams[rr].queue;
+            if (q.frames.empty()) {
+                q.deficit = 0;
+                next_queue();
+                ++idle;
+                continue;
+            }
+            idle = 0;
+            if (fresh) {
+                q.deficit += QUANTUM;
+                fresh = false;
+            }
+            if (q.frames.front().size() > q.deficit) {
+                next_queue();
+                continue;
+            }
+            auto t = now();
+            if (rate_bps > 0.0 && t < link_free) break;
+            size_t n = q.frames.front().size();
+            q.deficit -= n;
+            ++transmissions;
+            send(std::move(q.frames.front()));
+            q.frames.pop_front();
+            if (rate_bps > 0.0) {
+                link_free = std::max(link_free, t) +
+                            std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(8.0 * n / rate_bps));
+            }
+        }
+        report();
+    }
+
+    void report() {
+        delivered = 0;
+        for (size_t i = 0; i < streams.size(); ++i) {
+            Stream& s = streams[i];
+            delivered += s.arq->delivered;
+            if (s.reported || !s.arq->done()) continue;
+            s.reported = true;
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now() - t_start).count();
+            log() << "[MUX SENDER] stream " << i << " done: " << s.payloads->size() << " frames, "
+                  << s.arq->transmissions << " transmissions, t=" << ms << "ms\n";
+        }
+    }
+};
+
+// The real link without the per-frame log, for machines that run as one of
+// many streams.
+struct QuietLink : ArqLink {
+    ArqLink& real;
+    explicit QuietLink(ArqLink& l) : real(l) { out = &null_log(); }
+    clock::time_point now() override { return real.now(); }
+    int send(std::vector<uint8_t> wire) override { return real.send(std::move(wire)); }
+};
+
+// Demultiplexes by the header's stream byte into one SR receiver per
+// stream. A corrupted stream byte lands a frame on the wrong receiver, whose
+// CRC check rejects it like any other damaged frame.
+struct MuxReceiver : ArqMachine {
+    QuietLink quiet;
+    std::vector<std::unique_ptr<SrReceiver>> streams;
+
+    MuxReceiver(ArqLink& l, int count, int n, bool sack) : ArqMachine(l), quiet(l) {
+        for (int i = 0; i < count; ++i) {
+            streams.push_back(std::make_unique<SrReceiver>(quiet, n, sack));
+            streams.back()->stream = uint8_t(i);
+        }
+    }
+
+    bool wants_idle() const override {
+        for (auto& s : streams) {
+            if (s->wants_idle()) return true;
+        }
+        return false;
+    }
+
+    void on_idle() override {
+        for (auto& s : streams) {
+            if (s->wants_idle()) s->on_idle();
+        }
+    }
+
+    void on_frame(const std::vector<uint8_t>& buf) override {
+        if (buf.size() < (is_compact(buf.data(), buf.size()) ? COMPACT_MIN : HEADER_LEN)) return;
+        uint8_t id = Frame::stream_of(buf);
+        if (id >= streams.size()) return;
+        auto& s = *streams[id];
+        uint64_t before = s.delivered;
+        s.on_frame(buf);
+        delivered += s.delivered - before;
+    }
+
+    clock::time_point next_wakeup() override {
+        auto wake = clock::time_point::max();
+        for (auto& s : streams) wake = std::min(wake, s->next_wakeup());
+        return wake;
+    }
+
+    void on_tick() override {
+        auto t = now();
+        for (auto& s : streams) {
+            if (s->next_wakeup() <= t) s->on_tick();
+        }
+    }
+
+    clock::time_point sink_due() const override {
+        auto due = clock::time_point::max();
+        for (auto& s : streams) due = std::min(due, s->sink_due());
+        return due;
+    }
+
+    void poll_sink() override {
+        for (auto& s : streams) s->poll_sink();
+    }
+};
+
+} // namespace llc
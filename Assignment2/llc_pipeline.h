@@ -0,0 +1,100 @@
+#pragma once
+#include "llc_arq.h"
+#include "llc_spsc.h"
+
+namespace llc {
+
+// Selective Repeat sender split over three threads. A framing thread
+// encodes frames (header, copy and CRC) ahead of the window; the calling
+// thread owns the window and runs ACKs, timers and retransmissions; a
+// transmit thread applies the channel and writes the wire. Stages hand
+// frames over through SPSC rings, so no lock sits on the data path.
+struct SenderPipeline {
+    using clock = std::chrono::steady_clock;
+    static constexpr size_t RING = 256;
+
+    // The link the window thread sees: sending is a push onto the ring.
+    struct Link : ArqLink {
+        SenderPipeline& p;
+        explicit Link(SenderPipeline& pl) : p(pl) {}
+        clock::time_point now() override { return clock::now(); }
+        int send(std::vector<uint8_t> wire) override {
+            Backoff b;
+            while (!p.to_send.try_push(std::move(wire))) {
+                if (p.tx_failed) return -1;
+                b.wait();
+            }
+            return 1;
+        }
+    };
+
+    Wire& wire;
+    Channel& chan;
+    const PayloadSource& payloads;
+    SpscRing<Framed> framed{RING};
+    SpscRing<std::vector<uint8_t>> to_send{RING};
+    std::atomic<bool> stop{false};
+    std::atomic<bool> tx_failed{false};
+    Link link{*this};
+
+    SenderPipeline(Wire& w, Channel& c, const PayloadSource& p) : wire(w), chan(c), payloads(p) {}
+
+    bool run(SrSender& sender, const char* tag) {
+        sender.prebuilt = [this](Framed& f) { return framed.try_pop(f); };
+        std::thread framer([&] { frame_loop(sender); });
+        std::thread tx([&] { transmit_loop(); });
+        bool ok = run_sender(wire, sender, tag);
+        stop = true;
+        framer.join();
+        tx.join();
+        sender.prebuilt = nullptr;
+        return ok && !tx_failed;
+    }
+
+private:
+    // Frames carry seq = idx mod 256, which is what the sender assigns to
+    // new frames. The sender's FrameBuilder is only read here.
+    void frame_loop(const SrSender& s) {
+        Backoff b;
+        for (size_t i = 0; i < payloads.size() && !stop; ++i) {
+            Framed f;
+            Chunk c = payloads.at(i);
+            f.idx = i;
+            f.len = c.size;
+            f.ts = timestamp_us(clock::now());
+            f.wire = s.fb.encode(s.stream, uint8_t(i), c, f.ts);
+            while (!framed.try_push(std::move(f)) && !stop) b.wait();
+            b.reset();
+        }
+    }
+
+    void transmit_loop() {
+        Backoff b;
+        std::vector<uint8_t> w;
+        while (!stop) {
+            if (!to_send.try_pop(w)) {
+                if (b.spins == 0 && !wire.flush()) {
+                    tx_failed = true;
+                    return;
+                }
+                b.wait();
+                continue;
+            }
+            b.reset();
+            int r;
+            if (chan.immediate()) {
+                r = chan.impair(std::move(w), clock::now(), [&](clock::time_point, std::vector<uint8_t> bytes) {
+                    if (!wire.write(bytes.data(), bytes.size())) tx_failed = true;
+                });
+            } else {
+                r = chan.transmit(wire, std::move(w));
+            }
+            if (r < 0 || tx_failed) {
+                tx_failed = true;
+                return;
+            }
+        }
+    }
+};
+
+} // namespace llc
@@ -0,0 +1,248 @@
+#pragma once
+#include "llc_common.h"
+#include "llc_spsc.h"
+#include <mswsock.h>
+#include <deque>
+
+namespace llc {
+
+// Wire over Winsock Registered I/O (LLC_RIO) for bulk transfers. Frames are
+// copied into one send arena registered with the kernel at start, so a send
+// does not lock and probe its buffer, and go out as deferred RIOSends that
+// are committed together: once BATCH are waiting, or before the wire waits
+// or reads. Send completions, dequeued without a system call, return arena
+// space in FIFO order. Receives are kept posted into registered slots and
+// reposted once the reader has taken their bytes; an idle reader sleeps on
+// the receive completion queue's event. The socket must have been made
+// with WSA_FLAG_REGISTERED_IO. Sends may come from another thread (the
+// delay line or the transmit thread) than reads, so calls on the request
+// queue take a lock.
+struct RioWire : Wire {
+    using clock = std::chrono::steady_clock;
+    static constexpr DWORD ARENA = 4u << 20;        // registered send bytes
+    static constexpr DWORD MAX_SENDS = 1024;        // sends in flight
+    static constexpr DWORD BATCH = 32;              // deferred sends per commit
+    static constexpr DWORD RECV_SLOTS = 8;
+    static constexpr DWORD RECV_SLOT = 64u << 10;
+
+    struct Pending {
+        uint32_t bytes;   // frame plus any arena tail skipped to place it
+        bool done;
+    };
+    struct Filled {
+        DWORD slot;
+        DWORD len;
+        DWORD off;
+    };
+
+    SOCKET s;
+    RIO_EXTENSION_FUNCTION_TABLE rio{};
+    RIO_CQ send_cq = RIO_INVALID_CQ, recv_cq = RIO_INVALID_CQ;
+    RIO_RQ rq = RIO_INVALID_RQ;
+    HANDLE recv_event = nullptr;
+    char* send_mem = nullptr;
+    char* recv_mem = nullptr;
+    RIO_BUFFERID send_buf = RIO_INVALID_BUFFERID, recv_buf = RIO_INVALID_BUFFERID;
+
+    std::mutex rq_m;                  // rq, the arena and pending
+    uint64_t arena_head = 0, arena_tail = 0;
+    uint64_t first_id = 0;            // id of pending.front()
+    std::deque<Pending> pending;
+    DWORD deferred = 0;
+    bool send_failed = false;
+
+    std::deque<Filled> filled;        // completed receives, in stream order
+    bool eof = false;
+
+    RioWire(const RioWire&) = delete;
+    RioWire& operator=(const RioWire&) = delete;
+    ~RioWire() override {
+        if (rq != RIO_INVALID_RQ) {
+            flush();
+            drain_sends();
+        }
+        closesocket(s);
+        if (send_buf != RIO_INVALID_BUFFERID) rio.RIODeregisterBuffer(send_buf);
+        if (recv_buf != RIO_INVALID_BUFFERID) rio.RIODeregisterBuffer(recv_buf);
+        if (send_cq != RIO_INVALID_CQ) rio.RIOCloseCompletionQueue(send_cq);
+        if (recv_cq != RIO_INVALID_CQ) rio.RIOCloseCompletionQueue(recv_cq);
+        if (recv_event) WSACloseEvent(recv_event);
+        if (send_mem) VirtualFree(send_mem, 0, MEM_RELEASE);
+        if (recv_mem) VirtualFree(recv_mem, 0, MEM_RELEASE);
+    }
+
+    // Takes over `sock`; nullptr (with the socket closed) if RIO cannot be
+    // set up on it.
+    static std::unique_ptr<RioWire> open(SOCKET sock) {
+        std::unique_ptr<RioWire> w(new RioWire(sock));
+        if (!w->setup()) {
+            std::cerr << "Registered I/O setup failed (" << WSAGetLastError() << ")\n";
+            return nullptr;
+        }
+        return w;
+    }
+
+    bool write(const uint8_t* buf, size_t len) override {
+        if (len > ARENA / 2) return false;
+        std::unique_lock<std::mutex> lk(rq_m);
+        if (send_failed) return false;
+        uint64_t at = arena_tail % ARENA;
+        uint64_t skip = at + len > ARENA ? ARENA - at : 0;
+        Backoff b;
+        while (ARENA - (arena_tail - arena_head) < skip + len || pending.size() >= MAX_SENDS) {
+            if (deferred && !commit()) return false;
+            if (!reap_sends()) return false;
+            lk.unlock();
+            b.wait();
+            lk.lock();
+            at = arena_tail % ARENA;
+            skip = at + len > ARENA ? ARENA - at : 0;
+        }
+        arena_tail += skip;
+        at = arena_tail % ARENA;
+        std::memcpy(send_mem + at, buf, len);
+        arena_tail += len;
+        RIO_BUF rb{send_buf, ULONG(at), ULONG(len)};
+        uint64_t id = first_id + pending.size();
+        pending.push_back({uint32_t(skip + len), false});
+        if (!rio.RIOSend(rq, &rb, 1, RIO_MSG_DEFER, reinterpret_cast<void*>(uintptr_t(id)))) {
+            send_failed = true;
+            return false;
+        }
+        if (++deferred >= BATCH) return commit();
+        return true;
+    }
+
+    bool flush() override {
+        std::lock_guard<std::mutex> lk(rq_m);
+        if (send_failed) return false;
+        if (deferred && !commit()) return false;
+        return reap_sends();
+    }
+
+    int wait_readable(clock::time_point deadline) override {
+        if (!flush()) return -1;
+        return wait_recv(deadline) ? 1 : 0;
+    }
+
+    // Like recv_exact(), consumes what has arrived even if it then times out.
+    bool read_exact(uint8_t* buf, size_t len, int timeout_ms) override {
+        if (!flush()) return false;
+        auto deadline = clock::now() + std::chrono::milliseconds(timeout_ms);
+        size_t got = 0;
+        while (got < len) {
+            if (!wait_recv(deadline) || filled.empty()) return false;
+            Filled& f = filled.front();
+            size_t n = std::min<size_t>(len - got, f.len - f.off);
+            std::memcpy(buf + got, recv_mem + size_t(f.slot) * RECV_SLOT + f.off, n);
+            f.off += DWORD(n);
+            got += n;
+            if (f.off == f.len) {
+                DWORD slot = f.slot;
+                filled.pop_front();
+                if (!post_recv(slot)) return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    explicit RioWire(SOCKET sock) : s(sock) { direct = true; }
+
+    bool setup() {
+        GUID id = WSAID_MULTIPLE_RIO;
+        DWORD bytes = 0;
+        if (WSAIoctl(s, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &id, sizeof(id), &rio, sizeof(rio), &bytes,
+                     nullptr, nullptr) != 0)
+            return false;
+        recv_event = WSACreateEvent();
+        if (!recv_event) return false;
+        RIO_NOTIFICATION_COMPLETION nc{};
+        nc.Type = RIO_EVENT_COMPLETION;
+        nc.Event.EventHandle = recv_event;
+        nc.Event.NotifyReset = TRUE;
+        send_cq = rio.RIOCreateCompletionQueue(MAX_SENDS, nullptr);
+        recv_cq = rio.RIOCreateCompletionQueue(RECV_SLOTS, &nc);
+        if (send_cq == RIO_INVALID_CQ || recv_cq == RIO_INVALID_CQ) return false;
+        rq = rio.RIOCreateRequestQueue(s, RECV_SLOTS, 1, MAX_SENDS, 1, recv_cq, send_cq, nullptr);
+        if (rq == RIO_INVALID_RQ) return false;
+        send_mem = static_cast<char*>(VirtualAlloc(nullptr, ARENA, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        recv_mem = static_cast<char*>(
+            VirtualAlloc(nullptr, RECV_SLOTS * RECV_SLOT, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        if (!send_mem || !recv_mem) return false;
+        send_buf = rio.RIORegisterBuffer(send_mem, ARENA);
+        recv_buf = rio.RIORegisterBuffer(recv_mem, RECV_SLOTS * RECV_SLOT);
+        if (send_buf == RIO_INVALID_BUFFERID || recv_buf == RIO_INVALID_BUFFERID) return false;
+        for (DWORD i = 0; i < RECV_SLOTS; ++i)
+            if (!post_recv(i)) return false;
+        return true;
+    }
+
+    // Callers hold rq_m.
+    bool commit() {
+        deferred = 0;
+        if (!rio.RIOSend(rq, nullptr, 0, RIO_MSG_COMMIT_ONLY, nullptr)) send_failed = true;
+        return !send_failed;
+    }
+    bool reap_sends() {
+        RIORESULT res[64];
+        ULONG n;
+        while ((n = rio.RIODequeueCompletion(send_cq, res, 64)) > 0) {
+            if (n == RIO_CORRUPT_CQ) {
+                send_failed = true;
+                return false;
+            }
+            for (ULONG i = 0; i < n; ++i) {
+                if (res[i].Status != 0) send_failed = true;
+                pending[size_t(res[i].RequestContext - first_id)].done = true;
+            }
+            while (!pending.empty() && pending.front().done) {
+                arena_head += pending.front().bytes;
+                pending.pop_front();
+                ++first_id;
+            }
+        }
+        return !send_failed;
+    }
+    void drain_sends() {
+        auto give_up = clock::now() + std::chrono::seconds(2);
+        std::lock_guard<std::mutex> lk(rq_m);
+        while (!pending.empty() && reap_sends() && clock::now() < give_up) std::this_thread::yield();
+    }
+
+    bool post_recv(DWORD slot) {
+        std::lock_guard<std::mutex> lk(rq_m);
+        RIO_BUF rb{recv_buf, slot * RECV_SLOT, RECV_SLOT};
+        return rio.RIOReceive(rq, &rb, 1, 0, reinterpret_cast<void*>(uintptr_t(slot))) != FALSE;
+    }
+
+    // True once received bytes (or the end of the stream) are waiting;
+    // false at the deadline or on error.
+    bool wait_recv(clock::time_point deadline) {
+        while (filled.empty() && !eof) {
+            RIORESULT res[RECV_SLOTS];
+            ULONG n = rio.RIODequeueCompletion(recv_cq, res, RECV_SLOTS);
+            if (n == RIO_CORRUPT_CQ) return false;
+            for (ULONG i = 0; i < n; ++i) {
+                if (res[i].Status != 0 || res[i].BytesTransferred == 0) eof = true;
+                else filled.push_back({DWORD(res[i].RequestContext), res[i].BytesTransferred, 0});
+            }
+            if (n > 0) continue;
+            auto now = clock::now();
+            if (now >= deadline) return false;
+            DWORD ms = INFINITE;
+            if (deadline != clock::time_point::max()) {
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count();
+                ms = DWORD(std::min<int64_t>((us + 999) / 1000, 60000));
+            }
+            // Arms the event; WSAEALREADY means it is still armed from a
+            // wait that timed out.
+            int r = rio.RIONotify(recv_cq);
+            if (r != ERROR_SUCCESS && r != WSAEALREADY) return false;
+            WaitForSingleObject(recv_event, ms);
+        }
+        return true;
+    }
+};
+
+} // namespace llc
@@ -0,0 +1,217 @@
+#pragma once
+#include "llc_common.h"
+#include "llc_spsc.h"
+
+namespace llc {
+
+// One direction of a shared-memory link: a byte ring living in a mapped
+// region, with one producer and one consumer process. Positions are free
+// running 32-bit counters; a write publishes a whole frame with a single
+// release store of tail, so the reader never sees half of one.
+struct ShmRing {
+    static constexpr uint32_t CAPACITY = 1u << 20;   // bytes, power of two
+
+    alignas(64) std::atomic<uint32_t> head;      // next byte to read, written by the consumer
+    alignas(64) std::atomic<uint32_t> tail;      // next byte to fill, written by the producer
+    alignas(64) std::atomic<uint32_t> sleeping;  // consumer is (about to be) waiting on its event
+    std::atomic<uint32_t> writer_gone;
+    std::atomic<uint32_t> reader_gone;
+    alignas(64) uint8_t data[CAPACITY];
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "ring counters must be address-free");
+
+// The region both ends map: a ring each way. The creator sets `magic` once
+// the rings are initialised, and the other end sets `attached`.
+struct ShmRegion {
+    static constexpr uint32_t MAGIC = 0x4C4C4353;   // "LLCS"
+    std::atomic<uint32_t> magic;
+    std::atomic<uint32_t> attached;
+    ShmRing ring[2];   // [0] creator -> attacher, [1] attacher -> creator
+};
+
+// Wire over a named shared-memory region (LLC_SHM) for peers on the same
+// host: frames are copied straight into the peer's ring, with no socket,
+// no kernel buffer and, while both ends are busy, no system call. A reader
+// finding its ring empty spins briefly, then flags itself sleeping and
+// blocks on a named auto-reset event that the writer sets only when that
+// flag is up. A writer finding the ring full backs off until there is room.
+struct ShmWire : Wire {
+    using clock = std::chrono::steady_clock;
+    static constexpr int SPINS = 2000;
+
+    HANDLE mapping = nullptr;
+    HANDLE ev_out = nullptr, ev_in = nullptr;
+    ShmRegion* region = nullptr;
+    ShmRing* out = nullptr;
+    ShmRing* in = nullptr;
+    uint32_t head_seen = 0;   // producer's copy of out->head
+    uint32_t tail_seen = 0;   // consumer's copy of in->tail
+
+    ShmWire() { direct = true; }
+    ShmWire(const ShmWire&) = delete;
+    ShmWire& operator=(const ShmWire&) = delete;
+    ~ShmWire() override {
+        if (region) {
+            out->writer_gone.store(1, std::memory_order_release);
+            in->reader_gone.store(1, std::memory_order_release);
+            SetEvent(ev_out);
+            UnmapViewOfFile(region);
+        }
+        if (ev_out) CloseHandle(ev_out);
+        if (ev_in) CloseHandle(ev_in);
+        if (mapping) CloseHandle(mapping);
+    }
+
+    static std::string name(uint16_t port) { return "Local\\llc_shm_" + std::to_string(port); }
+
+    // Creates the region for `port`; nullptr if it exists already or cannot
+    // be made.
+    static std::unique_ptr<ShmWire> create(uint16_t port) {
+        std::unique_ptr<ShmWire> w(new ShmWire);
+        const std::string n = name(port);
+        w->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                        DWORD(sizeof(ShmRegion)), n.c_str());
+        if (!w->mapping || GetLastError() == ERROR_ALREADY_EXISTS) {
+            std::cerr << "Cannot create shared memory " << n << "\n";
+            return nullptr;
+        }
+        if (!w->map(0, n)) return nullptr;
+        ShmRegion* r = w->region;
+        r->attached.store(0, std::memory_order_relaxed);
+        for (ShmRing& ring : r->ring) {
+            ring.head.store(0, std::memory_order_relaxed);
+            ring.tail.store(0, std::memory_order_relaxed);
+            ring.sleeping.store(0, std::memory_order_relaxed);
+            ring.writer_gone.store(0, std::memory_order_relaxed);
+            ring.reader_gone.store(0, std::memory_order_relaxed);
+        }
+        r->magic.store(ShmRegion::MAGIC, std::memory_order_release);
+        return w;
+    }
+
+    // Maps the region another process created for `port`; nullptr if there
+    // is none.
+    static std::unique_ptr<ShmWire> attach(uint16_t port) {
+        std::unique_ptr<ShmWire> w(new ShmWire);
+        const std::string n = name(port);
+        w->mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, n.c_str());
+        if (!w->mapping) {
+            std::cerr << "No shared memory " << n << "\n";
+            return nullptr;
+        }
+        if (!w->map(1, n)) return nullptr;
+        if (w->region->magic.load(std::memory_order_acquire) != ShmRegion::MAGIC ||
+            w->region->attached.exchange(1, std::memory_order_acq_rel) != 0) {
+            std::cerr << "Shared memory " << n << " is not free\n";
+            return nullptr;
+        }
+        return w;
+    }
+
+    // Blocks until the other end has attached.
+    void wait_attached() {
+        while (!region->attached.load(std::memory_order_acquire)) Sleep(1);
+    }
+
+    bool write(const uint8_t* buf, size_t len) override {
+        if (len > ShmRing::CAPACITY) return false;
+        uint32_t t = out->tail.load(std::memory_order_relaxed);
+        if (ShmRing::CAPACITY - (t - head_seen) < len) {
+            Backoff b;
+            while (true) {
+                head_seen = out->head.load(std::memory_order_acquire);
+                if (ShmRing::CAPACITY - (t - head_seen) >= len) break;
+                if (out->reader_gone.load(std::memory_order_acquire)) return false;
+                b.wait();
+            }
+        }
+        if (out->reader_gone.load(std::memory_order_relaxed)) return false;
+        uint32_t at = t & (ShmRing::CAPACITY - 1);
+        size_t first = std::min<size_t>(len, ShmRing::CAPACITY - at);
+        std::memcpy(out->data + at, buf, first);
+        std::memcpy(out->data, buf + first, len - first);
+        out->tail.store(t + uint32_t(len), std::memory_order_release);
+        // Pairs with the fence in wait_for(): either the reader sees the new
+        // tail, or this sees its flag and wakes it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (out->sleeping.load(std::memory_order_relaxed)) SetEvent(ev_out);
+        return true;
+    }
+
+    int wait_readable(clock::time_point deadline) override {
+        return wait_for(deadline) ? 1 : 0;
+    }
+
+    // Like recv_exact(), consumes what has arrived even when it then times
+    // out, so a frame with a corrupted length field costs the same bytes as
+    // on a socket.
+    bool read_exact(uint8_t* buf, size_t len, int timeout_ms) override {
+        auto deadline = clock::now() + std::chrono::milliseconds(timeout_ms);
+        size_t got = 0;
+        while (got < len) {
+            if (!wait_for(deadline) || !available()) return false;
+            uint32_t h = in->head.load(std::memory_order_relaxed);
+            uint32_t at = h & (ShmRing::CAPACITY - 1);
+            size_t n = std::min<size_t>(len - got, tail_seen - h);
+            size_t first = std::min<size_t>(n, ShmRing::CAPACITY - at);
+            std::memcpy(buf + got, in->data + at, first);
+            std::memcpy(buf + got + first, in->data, n - first);
+            in->head.store(h + uint32_t(n), std::memory_order_release);
+            got += n;
+        }
+        return true;
+    }
+
+private:
+    bool map(int side, const std::string& n) {
+        void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ShmRegion));
+        if (!view) {
+            std::cerr << "Cannot map shared memory " << n << "\n";
+            return false;
+        }
+        region = static_cast<ShmRegion*>(view);
+        out = &region->ring[side];
+        in = &region->ring[1 - side];
+        ev_out = CreateEventA(nullptr, FALSE, FALSE, (n + (side ? "_up" : "_down")).c_str());
+        ev_in = CreateEventA(nullptr, FALSE, FALSE, (n + (side ? "_down" : "_up")).c_str());
+        if (!ev_out || !ev_in) {
+            std::cerr << "Cannot create events for " << n << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool available() {
+        uint32_t h = in->head.load(std::memory_order_relaxed);
+        if (tail_seen != h) return true;
+        tail_seen = in->tail.load(std::memory_order_acquire);
+        return tail_seen != h;
+    }
+
+    // True once bytes are waiting or the writer has left (reads then fail,
+    // as after a socket's EOF); false at the deadline.
+    bool wait_for(clock::time_point deadline) {
+        for (int i = 0; i < SPINS; ++i) {
+            if (available() || in->writer_gone.load(std::memory_order_acquire)) return true;
+        }
+        while (true) {
+            in->sleeping.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool ready = available() || in->writer_gone.load(std::memory_order_acquire);
+            auto now = clock::now();
+            if (ready || now >= deadline) {
+                in->sleeping.store(0, std::memory_order_relaxed);
+                return ready;
+            }
+            DWORD ms = INFINITE;
+            if (deadline != clock::time_point::max()) {
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count();
+                ms = DWORD(std::min<int64_t>((us + 999) / 1000, 60000));
+            }
+            WaitForSingleObject(ev_in, ms);
+            in->sleeping.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+} // namespace llc
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace llc {
+
+// Bounded single-producer single-consumer ring. Each side publishes its own
+// index with release and reads the other's with acquire, and only when its
+// cached copy says the ring looks full (producer) or empty (consumer), so in
+// steady state neither touches the other's cache line.
+template <class T>
+struct SpscRing {
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};   // next to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0};   // next to fill, written by the producer
+    alignas(64) size_t head_seen = 0;          // producer's copy of head
+    alignas(64) size_t tail_seen = 0;          // consumer's copy of tail
+
+    explicit SpscRing(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        slots.resize(cap);
+        mask = cap - 1;
+    }
+
+    bool try_push(T&& v) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head_seen == slots.size()) {
+            head_seen = head.load(std::memory_order_acquire);
+            if (t - head_seen == slots.size()) return false;
+        }
+        slots[t & mask] = std::move(v);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail_seen) {
+            tail_seen = tail.load(std::memory_order_acquire);
+            if (h == tail_seen) return false;
+        }
+        out = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// Wait strategy for a stage whose ring is empty or full: spin briefly, then
+// yield, then sleep, so an idle stage does not burn a core.
+struct Backoff {
+    int spins = 0;
+    void reset() { spins = 0; }
+    void wait() {
+        if (++spins < 64) return;
+        if (spins < 256) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+};
+
+} // namespace llc
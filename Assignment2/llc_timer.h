@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+namespace llc {
+
+// Per-sequence retransmission timers: a min-heap on deadline with lazy
+// cancellation. Each seq carries a generation counter, so cancel() is O(1)
+// and superseded heap entries are dropped when they surface at the top.
+struct TimerQueue {
+    using clock = std::chrono::steady_clock;
+    struct Entry {
+        clock::time_point when;
+        uint32_t gen;
+        uint8_t seq;
+    };
+
+    std::vector<Entry> heap;
+    uint32_t gen[256]{};
+    bool armed[256]{};
+    size_t live = 0;
+
+    void arm(uint8_t seq, clock::time_point when) {
+        if (!armed[seq]) { armed[seq] = true; ++live; }
+        ++gen[seq];
+        heap.push_back({when, gen[seq], seq});
+        std::push_heap(heap.begin(), heap.end(), later);
+        if (heap.size() > 2 * live + 64) compact();
+    }
+    void cancel(uint8_t seq) {
+        if (!armed[seq]) return;
+        armed[seq] = false;
+        ++gen[seq];
+        --live;
+    }
+    bool is_armed(uint8_t seq) const { return armed[seq]; }
+    bool empty() const { return live == 0; }
+
+    clock::time_point next_deadline() {
+        prune();
+        return heap.empty() ? clock::time_point::max() : heap.front().when;
+    }
+
+    void pop_expired(clock::time_point now, std::vector<uint8_t>& due) {
+        prune();
+        while (!heap.empty() && heap.front().when <= now) {
+            uint8_t s = heap.front().seq;
+            std::pop_heap(heap.begin(), heap.end(), later);
+            heap.pop_back();
+            armed[s] = false;
+            ++gen[s];
+            --live;
+            due.push_back(s);
+            prune();
+        }
+    }
+
+private:
+    static bool later(const Entry& a, const Entry& b) { return a.when > b.when; }
+    bool stale(const Entry& e) const { return !armed[e.seq] || e.gen != gen[e.seq]; }
+    void prune() {
+        while (!heap.empty() && stale(heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            heap.pop_back();
+        }
+    }
+    void compact() {
+        heap.erase(std::remove_if(heap.begin(), heap.end(), [&](const Entry& e) { return stale(e); }), heap.end());
+        std::make_heap(heap.begin(), heap.end(), later);
+    }
+};
+
+} // namespace llc
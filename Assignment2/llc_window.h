@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace llc {
+
+inline int ctz64(uint64_t x) {
+    if (x == 0) return 64;
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return int(i);
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// Sliding window over the 8-bit sequence space. Slots live in a power-of-two
+// ring indexed by seq & mask (256 is a multiple of every capacity, so the
+// mapping survives sequence wrap-around). One bit per slot records
+// acked (sender) or received (receiver).
+template <class Slot>
+struct RingWindow {
+    uint8_t base = 0;
+    int span = 0;
+    unsigned cap = 1, mask = 0;
+    std::vector<Slot> slots;
+    uint64_t bits[4]{};
+
+    explicit RingWindow(int n) : span(std::max(1, std::min(n, 256))) {
+        while (cap < unsigned(span)) cap <<= 1;
+        mask = cap - 1;
+        slots.resize(cap);
+    }
+
+    int offset(uint8_t seq) const { return int(uint8_t(seq - base)); }
+    bool contains(uint8_t seq) const { return offset(seq) < span; }
+    Slot& at(uint8_t seq) { return slots[seq & mask]; }
+    const Slot& at(uint8_t seq) const { return slots[seq & mask]; }
+
+    bool test(uint8_t seq) const {
+        unsigned i = seq & mask;
+        return (bits[i >> 6] >> (i & 63)) & 1u;
+    }
+    void set(uint8_t seq) {
+        unsigned i = seq & mask;
+        bits[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+    void reset(uint8_t seq) {
+        unsigned i = seq & mask;
+        bits[i >> 6] &= ~(uint64_t(1) << (i & 63));
+    }
+
+    // Length of the run of set bits starting at base.
+    int run_length() const {
+        int count = 0;
+        unsigned i = base & mask;
+        while (count < span) {
+            unsigned b = i & 63;
+            unsigned limit = std::min(64u - b, cap - i);
+            int ones = std::min(unsigned(ctz64(~(bits[i >> 6] >> b))), limit);
+            count += ones;
+            if (unsigned(ones) < limit) break;
+            i = (i + unsigned(ones)) & mask;
+        }
+        return std::min(count, span);
+    }
+
+    // Slides base over the set prefix, clearing it; returns how far it moved.
+    int advance() {
+        int n = run_length();
+        for (int k = 0; k < n; ++k) reset(uint8_t(base + k));
+        base = uint8_t(base + n);
+        return n;
+    }
+
+    // Cumulative slide (Go-Back-N): everything before new_base is released.
+    void advance_to(uint8_t new_base) {
+        while (base != new_base) {
+            reset(base);
+            base = uint8_t(base + 1);
+        }
+    }
+};
+
+} // namespace llc
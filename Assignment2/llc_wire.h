@@ -0,0 +1,70 @@
+#pragma once
+#include "llc_shm.h"
+#include "llc_rio.h"
+
+namespace llc {
+
+// Where a listening program meets its peer: a TCP port, read and written
+// through Registered I/O with LLC_RIO, or with LLC_SHM the shared-memory
+// region named after the port.
+struct WireListener {
+    SOCKET ls = INVALID_SOCKET;
+    bool rio = false;
+    std::unique_ptr<ShmWire> shm;
+
+    explicit WireListener(uint16_t port) {
+        if (!env_flag("LLC_SHM")) {
+            rio = env_flag("LLC_RIO");
+            // Accepted sockets inherit the flag RIO needs.
+            ls = make_listen_socket(port, WSA_FLAG_OVERLAPPED | (rio ? WSA_FLAG_REGISTERED_IO : 0));
+            return;
+        }
+        shm = ShmWire::create(port);
+        if (!shm) std::exit(1);
+        std::cout << "[SHM] Rings in " << ShmWire::name(port) << " (2 x " << (ShmRing::CAPACITY >> 10) << " KB)\n";
+    }
+    ~WireListener() {
+        if (ls != INVALID_SOCKET) closesocket(ls);
+    }
+
+    // The connected peer, or nullptr. Programs take a single peer, so the
+    // listening socket is closed once it has connected.
+    std::unique_ptr<Wire> accept() {
+        if (shm) {
+            shm->wait_attached();
+            return std::move(shm);
+        }
+        SOCKET conn = ::accept(ls, nullptr, nullptr);
+        closesocket(ls);
+        ls = INVALID_SOCKET;
+        if (conn == INVALID_SOCKET) {
+            std::cerr << "accept() failed\n";
+            return nullptr;
+        }
+        if (rio) return open_rio(conn);
+        return std::make_unique<SocketWire>(conn);
+    }
+
+    static std::unique_ptr<Wire> open_rio(SOCKET conn) {
+        auto w = RioWire::open(conn);
+        if (w) std::cout << "[RIO] Registered I/O (" << (RioWire::ARENA >> 20) << " MiB send arena, batches of "
+                         << RioWire::BATCH << ")\n";
+        return w;
+    }
+};
+
+inline std::unique_ptr<Wire> connect_wire(const char* host, uint16_t port) {
+    if (env_flag("LLC_SHM")) {
+        auto w = ShmWire::attach(port);
+        if (!w) std::exit(1);
+        return w;
+    }
+    if (env_flag("LLC_RIO")) {
+        auto w = WireListener::open_rio(make_connect_socket(host, port, WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO));
+        if (!w) std::exit(1);
+        return w;
+    }
+    return std::make_unique<SocketWire>(make_connect_socket(host, port));
+}
+
+} // namespace llc
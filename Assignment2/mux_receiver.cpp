@@ -0,0 +1,45 @@
+#include "llc_file.h"
+#include "llc_wire.h"
+#include "llc_mux.h"
+using namespace llc;
+
+static const uint16_t PORT = 8000;
+
+int main(int argc, char** argv) {
+    winsock_init();
+
+    int streams = std::min(64, std::max(1, argc >= 2 ? std::stoi(argv[1]) : 4));
+    int N = std::min(128, std::max(1, argc >= 3 ? std::stoi(argv[2]) : 4));
+    double p_err = (argc >= 4 ? std::stod(argv[3]) : 0.0);
+    int max_delay = (argc >= 5 ? std::stoi(argv[4]) : 0);
+    bool use_sack = (argc >= 6 && std::string(argv[5]) == "sack");
+    Channel chan{p_err, max_delay, 0.0};
+    chan.configure(std::getenv("LLC_CHANNEL"));
+
+    auto wire = connect_wire("127.0.0.1", PORT);
+    std::cout << "[MUX RECV] Connected (" << streams << " streams, N=" << N << (use_sack ? ", SACK" : "") << ")\n";
+
+    WireLink link(*wire, chan);
+    MuxReceiver receiver(link, streams, N, use_sack);
+    std::vector<std::unique_ptr<FileSink>> sinks;
+    for (int i = 0; i < streams; ++i) {
+        sinks.push_back(open_sink("[MUX RECV]", i));
+        receiver.streams[i]->sink = sinks.back().get();
+        receiver.streams[i]->compact = env_flag("LLC_COMPACT");
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    run_receiver(*wire, receiver, "[MUX RECV]", max_delay);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    for (int i = 0; i < streams; ++i) {
+        std::string tag = "[MUX RECV] stream " + std::to_string(i);
+        std::cout << tag << ": " << receiver.streams[i]->delivered << " frames delivered\n";
+        if (sinks[i]) sinks[i]->report(tag.c_str());
+        receiver.metrics.merge(receiver.streams[i]->metrics);
+    }
+    report_metrics("mux_receiver", "sr", N, receiver, chan, elapsed);
+    chan.close();
+    wire.reset();
+    winsock_cleanup();
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include "llc_file.h"
+#include "llc_wire.h"
+#include "llc_mux.h"
+using namespace llc;
+
+static const uint16_t PORT = 8000;
+
+int main(int argc, char** argv) {
+    winsock_init();
+
+    int streams = std::min(64, std::max(1, argc >= 2 ? std::stoi(argv[1]) : 4));
+    int N = std::min(128, std::max(1, argc >= 3 ? std::stoi(argv[2]) : 4));
+    double p_err = (argc >= 4 ? std::stod(argv[3]) : 0.0);
+    int max_delay = (argc >= 5 ? std::stoi(argv[4]) : 0);
+    std::string cc_kind = (argc >= 6 ? argv[5] : "fixed");
+    Channel chan{p_err, max_delay, 0.0};
+    chan.configure(std::getenv("LLC_CHANNEL"));
+
+    WireListener listener(PORT);
+    std::cout << "[MUX SENDER] Listening on " << PORT << " (" << streams << " streams, N=" << N
+              << ", cc=" << cc_kind << ")\n";
+    auto wire = listener.accept();
+    if (!wire) return 1;
+    std::cout << "[MUX SENDER] Connection established.\n";
+
+    WireLink link(*wire, chan);
+    MuxSender sender(link, chan.rate_bps);
+    size_t frames = 0;
+    for (int i = 0; i < streams; ++i) {
+        auto payloads = open_payloads("[MUX SENDER]");
+        if (!payloads) return 1;
+        frames += payloads->size();
+        sender.add(std::move(payloads), N, cc_kind);
+        sender.streams.back().arq->fb.offer_compact = env_flag("LLC_COMPACT");
+    }
+    bool ok = run_sender(*wire, sender, "[MUX SENDER]");
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - sender.t_start).count();
+    if (ok) {
+        std::cout << "[MUX SENDER] All streams delivered. " << frames << " frames in " << elapsed << "s ("
+                  << frames / std::max(elapsed, 1e-9) << " frames/s)\n";
+    }
+    for (auto& st : sender.streams) sender.metrics.merge(st.arq->metrics);
+    report_metrics("mux_sender", "sr", N, sender, chan, elapsed);
+    chan.close();
+    wire.reset();
+    winsock_cleanup();
+    return ok ? 0 : 1;
+}
@@ -1,143 +1,79 @@
-#include "llc_common.h"
-#ifndef NOMINMAX
-#define NOMINMAX
-#endif
-#include <windows.h>
-using namespace llc;
-
-static const uint16_t PORT = 8000;
-
-bool read_payloads(const std::string& path, std::vector<std::vector<uint8_t>>& out) {
-    std::ifstream in(path, std::ios::binary);
-    if (!in) return false;
-    std::string line;
-    while (std::getline(in, line)) {
-        std::vector<uint8_t> p(line.begin(), line.end());
-        if (p.size() < MIN_PAYLOAD) p.resize(MIN_PAYLOAD, uint8_t(' '));
-        out.emplace_back(std::move(p));
-    }
-    return true;
-}
-
-int main(int argc, char** argv) {
-    winsock_init();
-
-    int N = (argc >= 2 ? std::stoi(argv[1]) : 4);
-    double p_err = (argc >= 3 ? std::stod(argv[2]) : 0.0);
-    int max_delay = (argc >= 4 ? std::stoi(argv[3]) : 0);
-    Channel chan{p_err, max_delay, 0.0};
-
-    SOCKET ls = make_listen_socket(PORT);
-    std::cout << "[SR SENDER] Listening on " << PORT << " (N=" << N << ")\n";
-    SOCKET conn = accept(ls, nullptr, nullptr);
-    if (conn == INVALID_SOCKET) { std::cerr << "accept() failed\n"; return 1; }
-    std::cout << "[SR SENDER] Connection established.\n";
-
-    std::vector<std::vector<uint8_t>> payloads;
-    if (!read_payloads("data.txt", payloads) || payloads.empty()) {
-        std::cerr << "No data\n"; return 1;
-    }
-
-    uint8_t src[6], dst[6];
-    random_mac(src);
-    random_mac(dst);
-    RttEstimator rtt;
-
-    uint8_t base = 0;
-    uint8_t nextseq = 0;
-    size_t idx = 0;
-
-    struct Slot {
-        bool in_use = false;
-        bool acked = false;
-        std::vector<uint8_t> wire;
-        std::chrono::steady_clock::time_point deadline;
-    };
-    std::map<uint8_t, Slot> window;
-
-    auto in_window = [&](uint8_t s) {
-        int diff = int(uint8_t(s - base));
-        return 0 <= diff && diff < N;
-    };
-
-    auto send_or_resend = [&](uint8_t seq, bool is_resend) {
-        if (!window.count(seq)) return;
-        auto& slot = window[seq];
-        chan.apply_delay();
-        auto w = slot.wire;
-        chan.flip_bits(w);
-        if (!chan.maybe_drop()) send_all(conn, w.data(), w.size());
-        slot.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(int(rtt.rto_ms));
-        std::cout << "[SR SENDER] " << (is_resend ? "Resent" : "Sent") << " seq=" << int(seq) << "\n";
-    };
-
-    auto push_new = [&] {
-        while (in_window(nextseq) && idx < payloads.size()) {
-            Frame f;
-            std::copy(src, src + 6, f.src);
-            std::copy(dst, dst + 6, f.dst);
-            f.length = uint16_t(std::min<size_t>(payloads[idx].size(), 1500));
-            f.seq = nextseq;
-            f.payload = payloads[idx];
-            Slot slot;
-            slot.in_use = true;
-            slot.acked = false;
-            slot.wire = f.serialize_with_crc();
-            window[nextseq] = std::move(slot);
-            send_or_resend(nextseq, false);
-            ++idx;
-            nextseq = uint8_t(nextseq + 1);
-        }
-    };
-
-    push_new();
-
-    while (!window.empty()) {
-        u_long nb = 1;
-        ioctlsocket(conn, FIONBIO, &nb);
-        uint8_t ackbuf[6];
-        int r = recv(conn, reinterpret_cast<char*>(ackbuf), sizeof(ackbuf), 0);
-        nb = 0;
-        ioctlsocket(conn, FIONBIO, &nb);
-
-        if (r == sizeof(ackbuf)) {
-            Ack a{};
-            if (Ack::parse(ackbuf, sizeof(ackbuf), a)) {
-                if (a.type == ACK) {
-                    if (window.count(a.seq)) {
-                        window[a.seq].acked = true;
-                        std::cout << "[SR SENDER] ACK for " << int(a.seq) << "\n";
-                        while (!window.empty() && window.begin()->second.acked) {
-                            base = uint8_t(window.begin()->first + 1);
-                            window.erase(window.begin());
-                        }
-                        push_new();
-                    }
-                } else if (a.type == NAK) {
-                    if (window.count(a.seq)) {
-                        std::cout << "[SR SENDER] NAK for " << int(a.seq) << " -> retransmit\n";
-                        send_or_resend(a.seq, true);
-                    }
-                }
-            }
-        }
-
-        auto now = std::chrono::steady_clock::now();
-        for (auto& kv : window) {
-            auto& seq = kv.first;
-            auto& slot = kv.second;
-            if (!slot.acked && now >= slot.deadline) {
-                std::cout << "[SR SENDER] Timeout seq=" << int(seq) << " -> retransmit\n";
-                rtt.rto_ms = std::min(4000.0, rtt.rto_ms * 1.5);
-                send_or_resend(seq, true);
-            }
-        }
-        Sleep(10);
-    }
-
-    std::cout << "[SR SENDER] All frames delivered.\n";
-    closesocket(conn);
-    closesocket(ls);
-    winsock_cleanup();
-    return 0;
-}
+#include "llc_file.h"
+#include "llc_wire.h"
+#include "llc_pipeline.h"
+#include "llc_adapt.h"
+using namespace llc;
+
+static const uint16_t PORT = 8000;
+
+int main(int argc, char** argv) {
+    winsock_init();
+
+    int N = std::min(128, std::max(1, argc >= 2 ? std::stoi(argv[1]) : 4));
+    double p_err = (argc >= 3 ? std::stod(argv[2]) : 0.0);
+    int max_delay = (argc >= 4 ? std::stoi(argv[3]) : 0);
+    std::string cc_kind = (argc >= 5 ? argv[4] : "fixed");
+    size_t agg_bytes = (argc >= 6 ? size_t(std::stoul(argv[5])) : 0);
+    int agg_wait_ms = (argc >= 7 ? std::stoi(argv[6]) : 0);
+    Channel chan{p_err, max_delay, 0.0};
+    chan.configure(std::getenv("LLC_CHANNEL"));
+
+    WireListener listener(PORT);
+    std::cout << "[SR SENDER] Listening on " << PORT << " (N=" << N << ", cc=" << cc_kind;
+    if (agg_bytes) std::cout << ", aggregate " << agg_bytes << "B/" << agg_wait_ms << "ms";
+    std::cout << ")\n";
+    auto wire = listener.accept();
+    if (!wire) return 1;
+    std::cout << "[SR SENDER] Connection established.\n";
+
+    auto payloads = open_payloads("[SR SENDER]");
+    if (!payloads) return 1;
+
+    // LLC_PIPELINE runs framing, window and transmission on separate
+    // threads. Frames are built before the window sees them, so they are
+    // never aggregated.
+    bool pipelined = env_flag("LLC_PIPELINE");
+    // LLC_HARQ sends frames with per-block CRCs and parity (type-II hybrid
+    // ARQ); the receiver recognises them by their header flag.
+    bool harq = env_flag("LLC_HARQ");
+    // LLC_ADAPT re-cuts a file into frames sized for the bit error rate the
+    // sender observes. Lines of data.txt are records, so they keep their own
+    // frames. Chunks are cut on demand by the window, so not with the
+    // framing thread.
+    bool file = std::getenv("LLC_SEND_FILE") != nullptr;
+    bool adapt = env_flag("LLC_ADAPT") && file && !pipelined;
+    if (env_flag("LLC_ADAPT") && !file) std::cout << "[SR SENDER] LLC_ADAPT needs LLC_SEND_FILE, ignored\n";
+    WireLink link(*wire, chan);
+    SenderPipeline pipe(*wire, chan, *payloads);
+    AdaptiveSegmenter segments(*payloads, link, "[SR SENDER]");
+    const PayloadSource& source = adapt ? static_cast<const PayloadSource&>(segments) : *payloads;
+    SrSender sender(pipelined ? static_cast<ArqLink&>(pipe.link) : link, source, N, cc_kind);
+    segments.metrics = &sender.metrics;
+    // LLC_COMPACT: switch to the compact frame format once the receiver
+    // agrees. The framing thread reads the builder unlocked, so not there.
+    sender.fb.offer_compact = env_flag("LLC_COMPACT") && !pipelined;
+    bool ok;
+    if (harq && !pipelined) {
+        std::cout << "[SR SENDER] Hybrid ARQ: per-block CRC + incremental parity\n";
+        sender.harq = true;
+    }
+    if (adapt) std::cout << "[SR SENDER] Adaptive frame size from observed BER\n";
+    if (pipelined) {
+        std::cout << "[SR SENDER] Pipelined: framing / window / transmit threads\n";
+        ok = pipe.run(sender, "[SR SENDER]");
+    } else {
+        if (!adapt) sender.aggregate(agg_bytes, agg_wait_ms);
+        ok = run_sender(*wire, sender, "[SR SENDER]");
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - sender.t_start).count();
+    if (ok) {
+        std::cout << "[SR SENDER] All frames delivered. " << source.size() << " frames in " << elapsed << "s ("
+                  << source.size() / std::max(elapsed, 1e-9) << " frames/s)\n";
+    }
+    report_metrics("sr_sender", sender.harq ? "harq" : "sr", N, sender, chan, elapsed);
+    chan.close();
+    wire.reset();
+    winsock_cleanup();
+    return ok ? 0 : 1;
+}